@@ -18,6 +18,10 @@ void tb_flush(CPUState *cpu)
 {
 }
 
+void tcg_flush_jmp_cache(CPUState *cpu)
+{
+}
+
 void tlb_set_dirty(CPUState *cpu, vaddr vaddr)
 {
 }
@@ -42,6 +42,8 @@
 #include "tb-jmp-cache.h"
 #include "tb-hash.h"
 #include "tb-context.h"
+#include "tb-cache.h"
+#include "tb-spec.h"
 #include "internal-common.h"
 #include "internal-target.h"
 
@@ -187,7 +189,7 @@ static bool tb_lookup_cmp(const void *p, const void *d)
         tb_page_addr0(tb) == desc->page_addr0 &&
         tb->cs_base == desc->cs_base &&
         tb->flags == desc->flags &&
-        tb_cflags(tb) == desc->cflags) {
+        (tb_cflags(tb) & ~CF_TRACE) == desc->cflags) {
         /* check next page if needed */
         tb_page_addr_t tb_phys_page1 = tb_page_addr1(tb);
         if (tb_phys_page1 == -1) {
@@ -215,9 +217,9 @@ static bool tb_lookup_cmp(const void *p, const void *d)
     return false;
 }
 
-static TranslationBlock *tb_htable_lookup(CPUState *cpu, vaddr pc,
-                                          uint64_t cs_base, uint32_t flags,
-                                          uint32_t cflags)
+TranslationBlock *tb_htable_lookup(CPUState *cpu, vaddr pc,
+                                   uint64_t cs_base, uint32_t flags,
+                                   uint32_t cflags)
 {
     tb_page_addr_t phys_pc;
     struct tb_desc desc;
@@ -238,6 +240,101 @@ static TranslationBlock *tb_htable_lookup(CPUState *cpu, vaddr pc,
     return qht_lookup_custom(&tb_ctx.htable, &desc, h, tb_lookup_cmp);
 }
 
+/* Lookups between two decisions on the size of the jump cache. */
+#define TB_JMP_CACHE_WINDOW  (1 << 16)
+
+/*
+ * Grow the jump cache when more than 1/32 of the lookups in a window
+ * had to go to the victim cache or the qht for a TB that was already
+ * translated, and shrink it again below 1/512: with CF_PCREL, the whole
+ * cache is cleared on every TB invalidation.
+ */
+static void tb_jmp_cache_resize(CPUJumpCache *jc)
+{
+    size_t total = jc->victim_hits + jc->htable_hits;
+    size_t misses = total - jc->window_misses;
+    size_t n = jc->lookups - jc->window_lookups;
+    unsigned bits = jc->bits;
+
+    if (n < TB_JMP_CACHE_WINDOW) {
+        return;
+    }
+    jc->window_lookups = jc->lookups;
+    jc->window_misses = total;
+
+    /* Don't count the refill after the last resize against the new size. */
+    if (jc->settling) {
+        jc->settling = false;
+        return;
+    }
+    if (misses > n / 32 && bits < TB_JMP_CACHE_MAX_BITS) {
+        bits++;
+    } else if (misses < n / 512 && bits > TB_JMP_CACHE_MIN_BITS) {
+        bits--;
+    } else {
+        return;
+    }
+
+    /* The entries are placed by a hash of the size: start over empty. */
+    for (int i = 0; i < 1 << jc->bits; i++) {
+        qatomic_set(&jc->array[i].tb, NULL);
+    }
+    qatomic_set(&jc->bits, bits);
+    jc->settling = true;
+}
+
+static TranslationBlock *tb_jmp_victim_lookup(CPUJumpCache *jc, vaddr pc,
+                                              uint64_t cs_base,
+                                              uint32_t flags,
+                                              uint32_t cflags, int *slot)
+{
+    for (int i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        /* Use acquire to ensure current load of pc from jc. */
+        TranslationBlock *tb = qatomic_load_acquire(&jc->victim[i].tb);
+
+        if (tb &&
+            jc->victim[i].pc == pc &&
+            tb->cs_base == cs_base &&
+            tb->flags == flags &&
+            (tb_cflags(tb) & ~CF_TRACE) == cflags) {
+            *slot = i;
+            return tb;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Enter @tb into the jump cache, moving the TB it replaces to the
+ * victim cache: into @slot if that is >= 0, else round-robin.
+ */
+static void tb_jmp_cache_insert(CPUJumpCache *jc, uint32_t hash, vaddr pc,
+                                TranslationBlock *tb, int slot)
+{
+    TranslationBlock *old = qatomic_read(&jc->array[hash].tb);
+
+    if (old && old != tb) {
+        if (slot < 0) {
+            slot = jc->victim_next++ % TB_JMP_VICTIM_SIZE;
+        }
+        jc->victim[slot].pc = tb_cflags(old) & CF_PCREL
+                              ? jc->array[hash].pc : old->pc;
+        /* Ensure pc is written first. */
+        qatomic_store_release(&jc->victim[slot].tb, old);
+    } else if (slot >= 0) {
+        qatomic_set(&jc->victim[slot].tb, NULL);
+    }
+
+    if (tb_cflags(tb) & CF_PCREL) {
+        jc->array[hash].pc = pc;
+        /* Ensure pc is written first. */
+        qatomic_store_release(&jc->array[hash].tb, tb);
+    } else {
+        /* Use the pc value already stored in tb->pc. */
+        qatomic_set(&jc->array[hash].tb, tb);
+    }
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
                                           uint64_t cs_base, uint32_t flags,
@@ -246,12 +343,14 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
     TranslationBlock *tb;
     CPUJumpCache *jc;
     uint32_t hash;
+    int slot = -1;
 
     /* we should never be trying to look up an INVALID tb */
     tcg_debug_assert(!(cflags & CF_INVALID));
 
-    hash = tb_jmp_cache_hash_func(pc);
     jc = cpu->tb_jmp_cache;
+    hash = tb_jmp_cache_hash_func(pc, jc->bits);
+    qatomic_set(&jc->lookups, jc->lookups + 1);
 
     if (cflags & CF_PCREL) {
         /* Use acquire to ensure current load of pc from jc. */
@@ -261,16 +360,9 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
                    jc->array[hash].pc == pc &&
                    tb->cs_base == cs_base &&
                    tb->flags == flags &&
-                   tb_cflags(tb) == cflags)) {
+                   (tb_cflags(tb) & ~CF_TRACE) == cflags)) {
             return tb;
         }
-        tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
-        if (tb == NULL) {
-            return NULL;
-        }
-        jc->array[hash].pc = pc;
-        /* Ensure pc is written first. */
-        qatomic_store_release(&jc->array[hash].tb, tb);
     } else {
         /* Use rcu_read to ensure current load of pc from *tb. */
         tb = qatomic_rcu_read(&jc->array[hash].tb);
@@ -279,17 +371,26 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, vaddr pc,
                    tb->pc == pc &&
                    tb->cs_base == cs_base &&
                    tb->flags == flags &&
-                   tb_cflags(tb) == cflags)) {
+                   (tb_cflags(tb) & ~CF_TRACE) == cflags)) {
             return tb;
         }
+    }
+
+    tb = tb_jmp_victim_lookup(jc, pc, cs_base, flags, cflags, &slot);
+    if (tb) {
+        qatomic_set(&jc->victim_hits, jc->victim_hits + 1);
+    } else {
         tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
         if (tb == NULL) {
+            qatomic_set(&jc->htable_misses, jc->htable_misses + 1);
             return NULL;
         }
-        /* Use the pc value already stored in tb->pc. */
-        qatomic_set(&jc->array[hash].tb, tb);
+        qatomic_set(&jc->htable_hits, jc->htable_hits + 1);
     }
 
+    tb_jmp_cache_resize(jc);
+    hash = tb_jmp_cache_hash_func(pc, jc->bits);
+    tb_jmp_cache_insert(jc, hash, pc, tb, slot);
     return tb;
 }
 
@@ -432,6 +533,122 @@ const void *HELPER(lookup_tb_ptr)(CPUArchState *env)
     return tb->tc.ptr;
 }
 
+/*
+ * The miss path of translator_goto_ptr_cached(): look up the TB as usual
+ * and remember it in @slot as the target of @site for @key.
+ */
+const void *HELPER(lookup_tb_ptr_cached)(CPUArchState *env, void *slot,
+                                         uint64_t key, const void *site)
+{
+    CPUJumpCache *jc = env_cpu(env)->tb_jmp_cache;
+    TBIndirectEntry *e = slot;
+    /* Read first, so that a concurrent invalidation voids the entry. */
+    uint32_t gen = qatomic_read(&jc->ind_gen);
+    const void *ptr = HELPER(lookup_tb_ptr)(env);
+
+    /* Hits in the inline cache skip the exec log. */
+    if (ptr != tcg_code_gen_epilogue &&
+        !qemu_loglevel_mask(CPU_LOG_TB_CPU | CPU_LOG_EXEC)) {
+        e->key = key;
+        e->site = site;
+        e->host = ptr;
+        e->gen = gen;
+    }
+    return ptr;
+}
+
+/*
+ * Fill @pcs with the path most often taken out of @tb, following the
+ * chained jumps to successors that have run at least half as often as
+ * the threshold.  Stop at anything a trace cannot continue into: a
+ * different cpu state, another page, or a backward branch.
+ */
+static int tb_trace_path(TranslationBlock *tb, vaddr pc, vaddr *pcs)
+{
+    tb_page_addr_t page = tb_page_addr0(tb) & TARGET_PAGE_MASK;
+    int32_t warm = tb_hot_threshold / 2;
+    int n = 0;
+
+    while (n < TB_TRACE_MAX) {
+        tb_page_addr_t end = tb_page_addr0(tb) + tb->size;
+        TranslationBlock *next = NULL;
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            uintptr_t d = qatomic_read(&tb->jmp_dest[i]);
+            TranslationBlock *dest = (TranslationBlock *)(d & ~(uintptr_t)1);
+
+            if (dest == NULL ||
+                tb_cflags(dest) != tb_cflags(tb) ||
+                dest->flags != tb->flags ||
+                dest->cs_base != tb->cs_base ||
+                tb_page_addr1(dest) != -1 ||
+                (tb_page_addr0(dest) & TARGET_PAGE_MASK) != page ||
+                tb_page_addr0(dest) < end ||
+                qatomic_read(&dest->hot_count) > warm) {
+                continue;
+            }
+            if (next == NULL ||
+                qatomic_read(&dest->hot_count) <
+                qatomic_read(&next->hot_count)) {
+                next = dest;
+            }
+        }
+        if (next == NULL) {
+            break;
+        }
+        pcs[n++] = (pc & TARGET_PAGE_MASK) |
+                   (tb_page_addr0(next) & ~TARGET_PAGE_MASK);
+        tb = next;
+    }
+    return n;
+}
+
+/**
+ * helper_tb_hot: retranslate a hot TB as a trace
+ * @env: current cpu state
+ * @ptr: the TB, which has just been entered
+ *
+ * Called on entry to a TB whose hot_count has run out, before any of
+ * its insns have been executed.  Replace the TB with a CF_TRACE block
+ * that continues along the path its successors took most often, then
+ * restart execution from the start of the TB.
+ */
+void HELPER(tb_hot)(CPUArchState *env, void *ptr)
+{
+    CPUState *cpu = env_cpu(env);
+    CPUClass *cc = CPU_GET_CLASS(cpu);
+    TranslationBlock *tb = ptr;
+    uint32_t cflags = tb_cflags(tb);
+    vaddr pcs[TB_TRACE_MAX];
+    vaddr pc;
+    int n;
+
+    if (cc->tcg_ops->synchronize_from_tb) {
+        cc->tcg_ops->synchronize_from_tb(cpu, tb);
+    } else {
+        tcg_debug_assert(!(tb_cflags(tb) & CF_PCREL));
+        assert(cc->set_pc);
+        cc->set_pc(cpu, tb->pc);
+    }
+
+    /* Only one vCPU needs to get here. */
+    qatomic_set(&tb->hot_count, INT32_MAX);
+
+    if (!(cflags & CF_INVALID) && tb_page_addr1(tb) == -1) {
+        pc = log_pc(cpu, tb);
+        n = tb_trace_path(tb, pc, pcs);
+        if (n) {
+            mmap_lock();
+            tb_phys_invalidate(tb, -1);
+            translator_set_trace(pcs, n);
+            tb_gen_code(cpu, pc, tb->cs_base, tb->flags, cflags | CF_TRACE);
+            mmap_unlock();
+        }
+    }
+    cpu_loop_exit_noexc(cpu);
+}
+
 /* Execute a TB, and fix up the CPU state afterwards if necessary */
 /*
  * Disable CFI checks.
@@ -1004,22 +1221,17 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
 
                 mmap_lock();
                 tb = tb_gen_code(cpu, pc, cs_base, flags, cflags);
+                tb_spec_queue(cpu, tb);
+                tb_cache_record(cpu, tb, pc);
                 mmap_unlock();
 
                 /*
                  * We add the TB in the virtual pc hash table
                  * for the fast lookup
                  */
-                h = tb_jmp_cache_hash_func(pc);
                 jc = cpu->tb_jmp_cache;
-                if (cflags & CF_PCREL) {
-                    jc->array[h].pc = pc;
-                    /* Ensure pc is written first. */
-                    qatomic_store_release(&jc->array[h].tb, tb);
-                } else {
-                    /* Use the pc value already stored in tb->pc. */
-                    qatomic_set(&jc->array[h].tb, tb);
-                }
+                h = tb_jmp_cache_hash_func(pc, jc->bits);
+                tb_jmp_cache_insert(jc, h, pc, tb, -1);
             }
 
 #ifndef CONFIG_USER_ONLY
@@ -1100,6 +1312,7 @@ bool tcg_exec_realizefn(CPUState *cpu, Error **errp)
     }
 
     cpu->tb_jmp_cache = g_new0(CPUJumpCache, 1);
+    cpu->tb_jmp_cache->bits = TB_JMP_CACHE_BITS;
     tlb_init(cpu);
 #ifndef CONFIG_USER_ONLY
     tcg_iommu_init_notifier_list(cpu);
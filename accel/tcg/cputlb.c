@@ -105,16 +105,25 @@ static void tlb_window_reset(CPUTLBDesc *desc, int64_t ns,
 static void tb_jmp_cache_clear_page(CPUState *cpu, vaddr page_addr)
 {
     CPUJumpCache *jc = cpu->tb_jmp_cache;
+    unsigned bits;
     int i, i0;
 
     if (unlikely(!jc)) {
         return;
     }
 
-    i0 = tb_jmp_cache_hash_page(page_addr);
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
+    bits = qatomic_read(&jc->bits);
+    i0 = tb_jmp_cache_hash_page(page_addr, bits);
+    for (i = 0; i < 1 << tb_jmp_page_bits(bits); i++) {
         qatomic_set(&jc->array[i0 + i].tb, NULL);
     }
+    for (i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        if (qatomic_read(&jc->victim[i].tb) &&
+            (jc->victim[i].pc & TARGET_PAGE_MASK) == page_addr) {
+            qatomic_set(&jc->victim[i].tb, NULL);
+        }
+    }
+    qatomic_inc(&jc->ind_gen);
 }
 
 /**
@@ -235,8 +244,7 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
 {
     desc->n_used_entries = 0;
-    desc->large_page_addr = -1;
-    desc->large_page_mask = -1;
+    desc->n_large_pages = 0;
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
     memset(desc->vtable, -1, sizeof(desc->vtable));
@@ -264,6 +272,20 @@ static void tlb_mmu_init(CPUTLBDesc *desc, CPUTLBDescFast *fast, int64_t now)
     tlb_mmu_flush_locked(desc, fast);
 }
 
+/*
+ * The parked tables of one ASID, see tlb_switch_asid().  Only the mmu_idx
+ * in tlb_c.asid_idxmap are used; dirty has the same meaning as tlb_c.dirty.
+ * Protected by tlb_c.lock.
+ */
+struct CPUTLBBank {
+    bool in_use;
+    uint16_t dirty;
+    uint32_t asid;
+    uint64_t last_use;
+    CPUTLBDesc d[NB_MMU_MODES];
+    CPUTLBDescFast f[NB_MMU_MODES];
+};
+
 static inline void tlb_n_used_entries_inc(CPUState *cpu, uintptr_t mmu_idx)
 {
     cpu->neg.tlb.d[mmu_idx].n_used_entries++;
@@ -301,6 +323,18 @@ void tlb_destroy(CPUState *cpu)
         g_free(fast->table);
         g_free(desc->fulltlb);
     }
+    if (cpu->neg.tlb.c.banks) {
+        int b;
+
+        for (b = 0; b < CPU_TLB_BANKS; b++) {
+            for (i = 0; i < NB_MMU_MODES; i++) {
+                g_free(cpu->neg.tlb.c.banks[b].f[i].table);
+                g_free(cpu->neg.tlb.c.banks[b].d[i].fulltlb);
+            }
+        }
+        g_free(cpu->neg.tlb.c.banks);
+    }
+    g_free(cpu->neg.tlb.c.batch);
 }
 
 /* flush_all_helper: run fn across all cpus
@@ -322,6 +356,25 @@ static void flush_all_helper(CPUState *src, run_on_cpu_func fn,
     }
 }
 
+/*
+ * Drop the parked banks that have entries for any mmu_idx in @idxmap.
+ * Called with tlb_c.lock held.
+ */
+static void tlb_banks_flush_locked(CPUState *cpu, uint16_t idxmap)
+{
+    CPUTLBBank *banks = cpu->neg.tlb.c.banks;
+    int b;
+
+    if (!banks) {
+        return;
+    }
+    for (b = 0; b < CPU_TLB_BANKS; b++) {
+        if (banks[b].dirty & idxmap) {
+            banks[b].in_use = false;
+        }
+    }
+}
+
 static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 {
     uint16_t asked = data.host_int;
@@ -334,6 +387,8 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 
     qemu_spin_lock(&cpu->neg.tlb.c.lock);
 
+    tlb_banks_flush_locked(cpu, asked);
+
     all_dirty = cpu->neg.tlb.c.dirty;
     to_clean = asked & all_dirty;
     all_dirty &= ~to_clean;
@@ -379,6 +434,128 @@ void tlb_flush(CPUState *cpu)
     tlb_flush_by_mmuidx(cpu, ALL_MMUIDX_BITS);
 }
 
+size_t tlb_flush_generation(CPUState *cpu)
+{
+    CPUTLBCommon *c = &cpu->neg.tlb.c;
+
+    assert_cpu_is_self(cpu);
+    /*
+     * An ASID switch exchanges the live tables without counting as a
+     * flush, but still hands out different translations: asid_seq moves
+     * on every switch and on tlb_reset_asid().
+     */
+    return c->full_flush_count + c->part_flush_count +
+           c->elide_flush_count + c->page_flush_count + c->asid_seq;
+}
+
+void tlb_switch_asid(CPUState *cpu, uint16_t idxmap, uint32_t asid)
+{
+    CPUTLBCommon *c = &cpu->neg.tlb.c;
+    CPUTLBBank *bank = NULL, *victim = NULL;
+    uint16_t live_dirty, work;
+    int64_t now;
+    bool hit;
+    int i;
+
+    assert_cpu_is_self(cpu);
+
+    if (!c->asid_valid || c->asid_idxmap != idxmap) {
+        /*
+         * The live entries were loaded under an unknown ASID, or are
+         * tagged for another set of mmu_idx: start over from scratch.
+         */
+        tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(idxmap));
+        qemu_spin_lock(&c->lock);
+        tlb_banks_flush_locked(cpu, ALL_MMUIDX_BITS);
+        c->asid_idxmap = idxmap;
+        c->asid = asid;
+        c->asid_valid = true;
+        qemu_spin_unlock(&c->lock);
+        return;
+    }
+    if (c->asid == asid) {
+        return;
+    }
+
+    now = get_clock_realtime();
+    qemu_spin_lock(&c->lock);
+
+    if (!c->banks) {
+        c->banks = g_new0(CPUTLBBank, CPU_TLB_BANKS);
+    }
+    for (i = 0; i < CPU_TLB_BANKS; i++) {
+        CPUTLBBank *b = &c->banks[i];
+
+        if (b->in_use && b->asid == asid) {
+            bank = b;
+            break;
+        }
+        if (!victim || (victim->in_use &&
+                        (!b->in_use || b->last_use < victim->last_use))) {
+            victim = b;
+        }
+    }
+    hit = bank != NULL;
+    if (!hit) {
+        bank = victim;
+    }
+
+    /*
+     * Exchange the live tables with those of the bank.  On a miss the
+     * bank was empty or is evicted, so the live tables start out flushed.
+     */
+    for (work = idxmap; work != 0; work &= work - 1) {
+        int mmu_idx = ctz32(work);
+        CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+        CPUTLBDescFast *fast = &cpu->neg.tlb.f[mmu_idx];
+        CPUTLBDesc tmp_desc = bank->d[mmu_idx];
+        CPUTLBDescFast tmp_fast = bank->f[mmu_idx];
+
+        bank->d[mmu_idx] = *desc;
+        bank->f[mmu_idx] = *fast;
+        *desc = tmp_desc;
+        *fast = tmp_fast;
+
+        if (!fast->table) {
+            tlb_mmu_init(desc, fast, now);
+        } else if (!hit && (bank->dirty & (1 << mmu_idx))) {
+            tlb_mmu_flush_locked(desc, fast);
+        }
+    }
+
+    live_dirty = c->dirty & idxmap;
+    c->dirty &= ~idxmap;
+    if (hit) {
+        c->dirty |= bank->dirty & idxmap;
+    }
+    bank->dirty = live_dirty;
+    bank->in_use = live_dirty != 0;
+    bank->asid = c->asid;
+    bank->last_use = ++c->asid_seq;
+    c->asid = asid;
+
+    qemu_spin_unlock(&c->lock);
+
+    tcg_flush_jmp_cache(cpu);
+
+    if (hit) {
+        qatomic_set(&c->asid_hit_count, c->asid_hit_count + 1);
+    } else {
+        qatomic_set(&c->asid_miss_count, c->asid_miss_count + 1);
+    }
+}
+
+void tlb_reset_asid(CPUState *cpu)
+{
+    CPUTLBCommon *c = &cpu->neg.tlb.c;
+
+    qemu_spin_lock(&c->lock);
+    tlb_banks_flush_locked(cpu, ALL_MMUIDX_BITS);
+    c->asid_valid = false;
+    c->asid_seq++;
+    qemu_spin_unlock(&c->lock);
+}
+
 void tlb_flush_by_mmuidx_all_cpus(CPUState *src_cpu, uint16_t idxmap)
 {
     const run_on_cpu_func fn = tlb_flush_by_mmuidx_async_work;
@@ -473,22 +650,139 @@ static inline void tlb_flush_vtlb_page_locked(CPUState *cpu, int mmu_idx,
     tlb_flush_vtlb_page_mask_locked(cpu, mmu_idx, page, -1);
 }
 
-static void tlb_flush_page_locked(CPUState *cpu, int midx, vaddr page)
+/* Does [@addr, @addr + @len) overlap @lp, comparing under @mask? */
+static bool tlb_large_page_overlaps(const CPUTLBLargePage *lp,
+                                    vaddr addr, vaddr len, vaddr mask)
 {
-    vaddr lp_addr = cpu->neg.tlb.d[midx].large_page_addr;
-    vaddr lp_mask = cpu->neg.tlb.d[midx].large_page_mask;
+    vaddr start = addr & mask;
+    vaddr lp_start = lp->addr & mask;
 
-    /* Check if we need to flush due to large pages.  */
-    if ((page & lp_mask) == lp_addr) {
-        tlb_debug("forcing full flush midx %d (%016"
-                  VADDR_PRIx "/%016" VADDR_PRIx ")\n",
-                  midx, lp_addr, lp_mask);
-        tlb_flush_one_mmuidx_locked(cpu, midx, get_clock_realtime());
+    return start <= lp_start + ~lp->mask && lp_start <= start + len - 1;
+}
+
+/* Flush all the entries within @lp.  Called with tlb_c.lock held. */
+static void tlb_flush_large_page_locked(CPUState *cpu, int midx,
+                                        const CPUTLBLargePage *lp)
+{
+    CPUTLBDescFast *f = &cpu->neg.tlb.f[midx];
+    size_t n_entries = tlb_n_entries(f);
+    /* Keep TLB_INVALID_MASK significant, see tlb_hit_page_mask_anyprot. */
+    vaddr mask = lp->mask | ~TARGET_PAGE_MASK;
+    vaddr n_pages = (~lp->mask >> TARGET_PAGE_BITS) + 1;
+
+    tlb_debug("large page flush midx %d (%016" VADDR_PRIx "/%016"
+              VADDR_PRIx ")\n", midx, lp->addr, lp->mask);
+
+    /* Probe each page of the region, or scan the table if that's less. */
+    if (n_pages != 0 && n_pages < n_entries) {
+        for (vaddr i = 0; i < n_pages; i++) {
+            vaddr page = lp->addr + (i << TARGET_PAGE_BITS);
+
+            if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
+                tlb_n_used_entries_dec(cpu, midx);
+            }
+        }
     } else {
-        if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
-            tlb_n_used_entries_dec(cpu, midx);
+        for (size_t i = 0; i < n_entries; i++) {
+            if (tlb_flush_entry_mask_locked(&f->table[i], lp->addr, mask)) {
+                tlb_n_used_entries_dec(cpu, midx);
+            }
+        }
+    }
+    tlb_flush_vtlb_page_mask_locked(cpu, midx, lp->addr, mask);
+}
+
+/*
+ * Flush the entries of the large page regions that overlap
+ * [@addr, @addr + @len) under @mask, and forget those regions.
+ * Called with tlb_c.lock held.
+ */
+static void tlb_flush_large_pages_locked(CPUState *cpu, int midx,
+                                         vaddr addr, vaddr len, vaddr mask)
+{
+    CPUTLBDesc *d = &cpu->neg.tlb.d[midx];
+    unsigned i = 0;
+
+    while (i < d->n_large_pages) {
+        CPUTLBLargePage *lp = &d->large_page[i];
+
+        if (tlb_large_page_overlaps(lp, addr, len, mask)) {
+            tlb_flush_large_page_locked(cpu, midx, lp);
+            *lp = d->large_page[--d->n_large_pages];
+        } else {
+            i++;
+        }
+    }
+}
+
+static void tlb_flush_page_locked(CPUState *cpu, int midx, vaddr page)
+{
+    /* Check if we need to flush due to large pages.  */
+    tlb_flush_large_pages_locked(cpu, midx, page, TARGET_PAGE_SIZE, -1);
+
+    if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
+        tlb_n_used_entries_dec(cpu, midx);
+    }
+    tlb_flush_vtlb_page_locked(cpu, midx, page);
+}
+
+/*
+ * Flush the pages of [@addr, @addr + @len) matching under @mask from the
+ * tables parked for other ASIDs.  Called with tlb_c.lock held.
+ */
+static void tlb_banks_flush_range_locked(CPUState *cpu, uint16_t idxmap,
+                                         vaddr addr, vaddr len, vaddr mask)
+{
+    CPUTLBBank *banks = cpu->neg.tlb.c.banks;
+    int b, k;
+
+    if (!banks) {
+        return;
+    }
+    for (b = 0; b < CPU_TLB_BANKS; b++) {
+        CPUTLBBank *bank = &banks[b];
+        uint16_t work;
+
+        if (!bank->in_use) {
+            continue;
         }
-        tlb_flush_vtlb_page_locked(cpu, midx, page);
+        for (work = idxmap & bank->dirty; work != 0; work &= work - 1) {
+            int mmu_idx = ctz32(work);
+            CPUTLBDesc *d = &bank->d[mmu_idx];
+            CPUTLBDescFast *f = &bank->f[mmu_idx];
+            uintptr_t size_mask = f->mask >> CPU_TLB_ENTRY_BITS;
+            bool full = mask < f->mask || len > f->mask;
+
+            /*
+             * As for tlb_flush_range_locked, but without resizing.
+             * Parked tables are flushed in full for large pages.
+             */
+            for (k = 0; k < d->n_large_pages && !full; k++) {
+                full = tlb_large_page_overlaps(&d->large_page[k],
+                                               addr, len, mask);
+            }
+            if (full) {
+                tlb_mmu_flush_locked(d, f);
+                bank->dirty &= ~(1 << mmu_idx);
+                continue;
+            }
+            for (vaddr i = 0; i < len; i += TARGET_PAGE_SIZE) {
+                vaddr page = addr + i;
+                CPUTLBEntry *entry =
+                    &f->table[(page >> TARGET_PAGE_BITS) & size_mask];
+
+                if (tlb_flush_entry_mask_locked(entry, page, mask)) {
+                    d->n_used_entries--;
+                }
+                for (k = 0; k < CPU_VTLB_SIZE; k++) {
+                    if (tlb_flush_entry_mask_locked(&d->vtable[k],
+                                                    page, mask)) {
+                        d->n_used_entries--;
+                    }
+                }
+            }
+        }
+        bank->in_use = bank->dirty != 0;
     }
 }
 
@@ -517,7 +811,10 @@ static void tlb_flush_page_by_mmuidx_async_0(CPUState *cpu,
             tlb_flush_page_locked(cpu, mmu_idx, addr);
         }
     }
+    tlb_banks_flush_range_locked(cpu, idxmap, addr, TARGET_PAGE_SIZE, -1);
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
+    qatomic_set(&cpu->neg.tlb.c.page_flush_count,
+                cpu->neg.tlb.c.page_flush_count + 1);
 
     /*
      * Discard jump cache entries for any tb which might potentially
@@ -694,7 +991,6 @@ static void tlb_flush_range_locked(CPUState *cpu, int midx,
                                    vaddr addr, vaddr len,
                                    unsigned bits)
 {
-    CPUTLBDesc *d = &cpu->neg.tlb.d[midx];
     CPUTLBDescFast *f = &cpu->neg.tlb.f[midx];
     vaddr mask = MAKE_64BIT_MASK(0, bits);
 
@@ -716,18 +1012,8 @@ static void tlb_flush_range_locked(CPUState *cpu, int midx,
         return;
     }
 
-    /*
-     * Check if we need to flush due to large pages.
-     * Because large_page_mask contains all 1's from the msb,
-     * we only need to test the end of the range.
-     */
-    if (((addr + len - 1) & d->large_page_mask) == d->large_page_addr) {
-        tlb_debug("forcing full flush midx %d ("
-                  "%016" VADDR_PRIx "/%016" VADDR_PRIx ")\n",
-                  midx, d->large_page_addr, d->large_page_mask);
-        tlb_flush_one_mmuidx_locked(cpu, midx, get_clock_realtime());
-        return;
-    }
+    /* Check if we need to flush due to large pages.  */
+    tlb_flush_large_pages_locked(cpu, midx, addr, len, mask);
 
     for (vaddr i = 0; i < len; i += TARGET_PAGE_SIZE) {
         vaddr page = addr + i;
@@ -763,13 +1049,17 @@ static void tlb_flush_range_by_mmuidx_async_0(CPUState *cpu,
             tlb_flush_range_locked(cpu, mmu_idx, d.addr, d.len, d.bits);
         }
     }
+    tlb_banks_flush_range_locked(cpu, d.idxmap, d.addr, d.len,
+                                 MAKE_64BIT_MASK(0, d.bits));
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
+    qatomic_set(&cpu->neg.tlb.c.page_flush_count,
+                cpu->neg.tlb.c.page_flush_count + 1);
 
     /*
      * If the length is larger than the jump cache size, then it will take
      * longer to clear each entry individually than it will to clear it all.
      */
-    if (d.len >= (TARGET_PAGE_SIZE * TB_JMP_CACHE_SIZE)) {
+    if (d.len >= ((vaddr)TARGET_PAGE_SIZE << cpu->tb_jmp_cache->bits)) {
         tcg_flush_jmp_cache(cpu);
         return;
     }
@@ -935,6 +1225,128 @@ void tlb_flush_page_bits_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                               idxmap, bits);
 }
 
+/*
+ * Guests follow a sequence of broadcast invalidations with a single
+ * barrier, but each synced flush costs a separate exclusive section.
+ * The batched variants instead collect the flushes on the source cpu,
+ * and tlb_flush_batch_sync() sends them to every cpu as one work item
+ * with one synchronisation.
+ */
+#define TLB_FLUSH_BATCH_SIZE 16
+
+struct CPUTLBFlushBatch {
+    /* mmu_idx to flush in full, which covers any range for them */
+    uint16_t full_idxmap;
+    unsigned n;
+    TLBFlushRangeData range[TLB_FLUSH_BATCH_SIZE];
+};
+
+static CPUTLBFlushBatch *tlb_flush_batch(CPUState *cpu)
+{
+    assert_cpu_is_self(cpu);
+    if (!cpu->neg.tlb.c.batch) {
+        cpu->neg.tlb.c.batch = g_new0(CPUTLBFlushBatch, 1);
+    }
+    return cpu->neg.tlb.c.batch;
+}
+
+static void tlb_flush_batch_async_work(CPUState *cpu, run_on_cpu_data data)
+{
+    CPUTLBFlushBatch *b = data.host_ptr;
+    unsigned i;
+
+    if (b->full_idxmap) {
+        tlb_flush_by_mmuidx_async_work(cpu,
+                                       RUN_ON_CPU_HOST_INT(b->full_idxmap));
+    }
+    for (i = 0; i < b->n; i++) {
+        TLBFlushRangeData d = b->range[i];
+
+        d.idxmap &= ~b->full_idxmap;
+        if (d.idxmap) {
+            tlb_flush_range_by_mmuidx_async_0(cpu, d);
+        }
+    }
+    g_free(b);
+}
+
+void tlb_flush_by_mmuidx_all_cpus_batched(CPUState *src_cpu, uint16_t idxmap)
+{
+    tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
+
+    tlb_flush_batch(src_cpu)->full_idxmap |= idxmap;
+}
+
+void tlb_flush_range_by_mmuidx_all_cpus_batched(CPUState *src_cpu,
+                                                vaddr addr,
+                                                vaddr len,
+                                                uint16_t idxmap,
+                                                unsigned bits)
+{
+    CPUTLBFlushBatch *b = tlb_flush_batch(src_cpu);
+    TLBFlushRangeData d;
+    unsigned i;
+
+    /* If no page bits are significant, this devolves to tlb_flush. */
+    if (bits < TARGET_PAGE_BITS) {
+        tlb_flush_by_mmuidx_all_cpus_batched(src_cpu, idxmap);
+        return;
+    }
+
+    d.addr = addr & TARGET_PAGE_MASK;
+    d.len = len;
+    d.idxmap = idxmap & ~b->full_idxmap;
+    d.bits = bits;
+    if (!d.idxmap) {
+        return;
+    }
+
+    /* Merge with a batched range that this overlaps or extends. */
+    for (i = 0; i < b->n; i++) {
+        TLBFlushRangeData *r = &b->range[i];
+
+        if (r->idxmap == d.idxmap && r->bits == d.bits &&
+            d.addr <= r->addr + r->len && r->addr <= d.addr + d.len) {
+            vaddr end = MAX(r->addr + r->len, d.addr + d.len);
+
+            r->addr = MIN(r->addr, d.addr);
+            r->len = end - r->addr;
+            return;
+        }
+    }
+
+    if (b->n == TLB_FLUSH_BATCH_SIZE) {
+        /* Too scattered to be worth tracking page by page. */
+        b->full_idxmap |= d.idxmap;
+        return;
+    }
+    b->range[b->n++] = d;
+}
+
+bool tlb_flush_batch_sync(CPUState *src_cpu)
+{
+    CPUTLBFlushBatch *b = src_cpu->neg.tlb.c.batch;
+    CPUState *dst_cpu;
+
+    if (!b || (!b->full_idxmap && !b->n)) {
+        return false;
+    }
+
+    /* Allocate a separate copy of the batch for each destination cpu.  */
+    CPU_FOREACH(dst_cpu) {
+        if (dst_cpu != src_cpu) {
+            async_run_on_cpu(dst_cpu, tlb_flush_batch_async_work,
+                             RUN_ON_CPU_HOST_PTR(g_memdup(b, sizeof(*b))));
+        }
+    }
+    async_safe_run_on_cpu(src_cpu, tlb_flush_batch_async_work,
+                          RUN_ON_CPU_HOST_PTR(g_memdup(b, sizeof(*b))));
+
+    b->full_idxmap = 0;
+    b->n = 0;
+    return true;
+}
+
 /* update the TLBs so that writes to code in the virtual page 'addr'
    can be detected */
 void tlb_protect_code(ram_addr_t ram_addr)
@@ -1025,6 +1437,32 @@ void tlb_reset_dirty(CPUState *cpu, ram_addr_t start1, ram_addr_t length)
                                          start1, length);
         }
     }
+    if (cpu->neg.tlb.c.banks) {
+        int b;
+
+        for (b = 0; b < CPU_TLB_BANKS; b++) {
+            CPUTLBBank *bank = &cpu->neg.tlb.c.banks[b];
+            uint16_t work;
+
+            if (!bank->in_use) {
+                continue;
+            }
+            for (work = bank->dirty; work != 0; work &= work - 1) {
+                unsigned int i, n;
+
+                mmu_idx = ctz32(work);
+                n = tlb_n_entries(&bank->f[mmu_idx]);
+                for (i = 0; i < n; i++) {
+                    tlb_reset_dirty_range_locked(&bank->f[mmu_idx].table[i],
+                                                 start1, length);
+                }
+                for (i = 0; i < CPU_VTLB_SIZE; i++) {
+                    tlb_reset_dirty_range_locked(&bank->d[mmu_idx].vtable[i],
+                                                 start1, length);
+                }
+            }
+        }
+    }
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
 }
 
@@ -1060,28 +1498,48 @@ void tlb_set_dirty(CPUState *cpu, vaddr addr)
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
 }
 
-/* Our TLB does not support large pages, so remember the area covered by
-   large pages and trigger a full TLB flush if these are invalidated.  */
+/* Our TLB does not support large pages, so remember the areas covered by
+   large pages and flush all of an area if any page in it is invalidated.  */
 static void tlb_add_large_page(CPUState *cpu, int mmu_idx,
                                vaddr addr, uint64_t size)
 {
-    vaddr lp_addr = cpu->neg.tlb.d[mmu_idx].large_page_addr;
+    CPUTLBDesc *d = &cpu->neg.tlb.d[mmu_idx];
     vaddr lp_mask = ~(size - 1);
+    CPUTLBLargePage *best = NULL;
+    vaddr best_mask = 0;
+    unsigned i;
 
-    if (lp_addr == (vaddr)-1) {
-        /* No previous large page.  */
-        lp_addr = addr;
-    } else {
-        /* Extend the existing region to include the new page.
-           This is a compromise between unnecessary flushes and
-           the cost of maintaining a full variable size TLB.  */
-        lp_mask &= cpu->neg.tlb.d[mmu_idx].large_page_mask;
-        while (((lp_addr ^ addr) & lp_mask) != 0) {
-            lp_mask <<= 1;
+    for (i = 0; i < d->n_large_pages; i++) {
+        CPUTLBLargePage *lp = &d->large_page[i];
+        vaddr mask = lp_mask & lp->mask;
+
+        /* The smallest region covering both this one and the new page. */
+        while (((lp->addr ^ addr) & mask) != 0) {
+            mask <<= 1;
+        }
+        if (mask == lp->mask || mask == lp_mask) {
+            /* One of them already contains the other.  */
+            lp->addr &= mask;
+            lp->mask = mask;
+            return;
         }
+        /* The mask may be 0 if the addresses differ in the msb. */
+        if (best == NULL || mask > best_mask) {
+            best = lp;
+            best_mask = mask;
+        }
+    }
+
+    if (d->n_large_pages < CPU_TLB_LARGE_PAGES) {
+        best = &d->large_page[d->n_large_pages++];
+        best->addr = addr;
+        best_mask = lp_mask;
     }
-    cpu->neg.tlb.d[mmu_idx].large_page_addr = lp_addr & lp_mask;
-    cpu->neg.tlb.d[mmu_idx].large_page_mask = lp_mask;
+    /* Otherwise extend the region that grows the least.
+       This is a compromise between unnecessary flushes and
+       the cost of maintaining a full variable size TLB.  */
+    best->addr &= best_mask;
+    best->mask = best_mask;
 }
 
 static inline void tlb_set_compare(CPUTLBEntryFull *full, CPUTLBEntry *ent,
@@ -13,6 +13,7 @@
 
 extern int64_t max_delay;
 extern int64_t max_advance;
+extern bool tb_profile;
 
 /*
  * Return true if CS is not running in parallel with other cpus, either
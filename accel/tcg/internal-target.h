@@ -72,10 +72,26 @@ G_NORETURN void cpu_io_recompile(CPUState *cpu, uintptr_t retaddr);
 TranslationBlock *tb_gen_code(CPUState *cpu, vaddr pc,
                               uint64_t cs_base, uint32_t flags,
                               int cflags);
+#ifdef CONFIG_SOFTMMU
+/*
+ * Translate and link a TB for @cpu, with the page of @pc already looked
+ * up as @phys_pc/@host_pc, without touching the TLB of @cpu or flushing
+ * the code buffer.  May be called from a thread other than the vCPU
+ * thread.  Return NULL if the TB would need either.
+ */
+TranslationBlock *tb_gen_code_background(CPUState *cpu, vaddr pc,
+                                         uint64_t cs_base, uint32_t flags,
+                                         int cflags, tb_page_addr_t phys_pc,
+                                         void *host_pc);
+#endif
+TranslationBlock *tb_htable_lookup(CPUState *cpu, vaddr pc,
+                                   uint64_t cs_base, uint32_t flags,
+                                   uint32_t cflags);
 void page_init(void);
 void tb_htable_init(void);
 void tb_reset_jump(TranslationBlock *tb, int n);
 TranslationBlock *tb_link_page(TranslationBlock *tb);
+void tb_reclaim(CPUState *cpu);
 bool tb_invalidate_phys_page_unwind(tb_page_addr_t addr, uintptr_t pc);
 void cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
                                uintptr_t host_pc);
@@ -94,6 +110,19 @@ static inline vaddr log_pc(CPUState *cpu, const TranslationBlock *tb)
 }
 
 extern bool one_insn_per_tb;
+extern uint32_t tb_hot_threshold;
+
+/* Set the path for the next CF_TRACE translation on this thread. */
+void translator_set_trace(const vaddr *pcs, int n);
+
+/* Return the direct branch targets of the last TB translated here. */
+int translator_exits(const vaddr **dests);
+
+/*
+ * With @background, cut short the next translations on this thread
+ * rather than use the vCPU TLB.
+ */
+void translator_set_background(bool background);
 
 /**
  * tcg_req_mo:
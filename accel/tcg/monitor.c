@@ -19,6 +19,7 @@
 #include "tcg/tcg.h"
 #include "internal-common.h"
 #include "tb-context.h"
+#include "tb-jmp-cache.h"
 
 
 static void dump_drift_info(GString *buf)
@@ -141,6 +142,57 @@ static void tlb_flush_counts(size_t *pfull, size_t *ppart, size_t *pelide)
     *pelide = elide;
 }
 
+static void tlb_asid_counts(size_t *phit, size_t *pmiss)
+{
+    CPUState *cpu;
+    size_t hit = 0, miss = 0;
+
+    CPU_FOREACH(cpu) {
+        hit += qatomic_read(&cpu->neg.tlb.c.asid_hit_count);
+        miss += qatomic_read(&cpu->neg.tlb.c.asid_miss_count);
+    }
+    *phit = hit;
+    *pmiss = miss;
+}
+
+static void dump_jmp_cache_info(GString *buf)
+{
+    size_t lookups = 0, victim = 0, hit = 0, miss = 0;
+    unsigned min_bits = UINT_MAX, max_bits = 0;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        CPUJumpCache *jc = cpu->tb_jmp_cache;
+        unsigned bits;
+
+        if (!jc) {
+            continue;
+        }
+        bits = qatomic_read(&jc->bits);
+        lookups += qatomic_read(&jc->lookups);
+        victim += qatomic_read(&jc->victim_hits);
+        hit += qatomic_read(&jc->htable_hits);
+        miss += qatomic_read(&jc->htable_misses);
+        min_bits = MIN(min_bits, bits);
+        max_bits = MAX(max_bits, bits);
+    }
+    if (!lookups) {
+        return;
+    }
+
+    g_string_append_printf(buf, "TB jmp cache size   %u-%u entries\n",
+                           1u << min_bits, 1u << max_bits);
+    g_string_append_printf(buf, "TB jmp cache hits   %zu/%zu (%0.2f%%)\n",
+                           lookups - victim - hit - miss, lookups,
+                           (double)(lookups - victim - hit - miss) /
+                           lookups * 100);
+    g_string_append_printf(buf, "TB victim hits      %zu (%0.2f%%)\n",
+                           victim, (double)victim / lookups * 100);
+    g_string_append_printf(buf, "TB hash lookups     %zu (%0.2f%%), "
+                           "%zu found\n", hit + miss,
+                           (double)(hit + miss) / lookups * 100, hit);
+}
+
 static void tcg_dump_info(GString *buf)
 {
     g_string_append_printf(buf, "[TCG profiler not compiled]\n");
@@ -151,6 +203,7 @@ static void dump_exec_info(GString *buf)
     struct tb_tree_stats tst = {};
     struct qht_stats hst;
     size_t nb_tbs, flush_full, flush_part, flush_elide;
+    size_t asid_hit, asid_miss;
 
     tcg_tb_foreach(tb_tree_stats_iter, &tst);
     nb_tbs = tst.nb_tbs;
@@ -191,11 +244,19 @@ static void dump_exec_info(GString *buf)
                            qatomic_read(&tb_ctx.tb_flush_count));
     g_string_append_printf(buf, "TB invalidate count %u\n",
                            qatomic_read(&tb_ctx.tb_phys_invalidate_count));
+    g_string_append_printf(buf, "TB reclaim count    %u\n",
+                           qatomic_read(&tb_ctx.tb_reclaim_count));
+    g_string_append_printf(buf, "SMC false sharing   %u\n",
+                           qatomic_read(&tb_ctx.tb_smc_false_share_count));
 
     tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
     g_string_append_printf(buf, "TLB full flushes    %zu\n", flush_full);
     g_string_append_printf(buf, "TLB partial flushes %zu\n", flush_part);
     g_string_append_printf(buf, "TLB elided flushes  %zu\n", flush_elide);
+    tlb_asid_counts(&asid_hit, &asid_miss);
+    g_string_append_printf(buf, "TLB ASID switches   %zu hit, %zu miss\n",
+                           asid_hit, asid_miss);
+    dump_jmp_cache_info(buf);
     tcg_dump_info(buf);
 }
 
@@ -235,10 +296,113 @@ HumanReadableText *qmp_x_query_opcount(Error **errp)
     return human_readable_text_from_str(buf);
 }
 
+typedef struct TBProfile {
+    vaddr pc;
+    tb_page_addr_t phys_pc;
+    uint16_t icount;
+    uint32_t host_size;
+    uint64_t exec;
+    uint64_t chained;
+    uint64_t lookup;
+    uint64_t exit;
+} TBProfile;
+
+/*
+ * Copy the counters out while walking the tree: the TBs themselves may
+ * be freed by a tb_flush as soon as the walk is over.
+ */
+static gboolean tb_profile_iter(gpointer key, gpointer value, gpointer data)
+{
+    const TranslationBlock *tb = value;
+    GArray *profs = data;
+    uint64_t goto_tb = qatomic_read__nocheck(&tb->prof.goto_tb);
+    uint64_t unchained = qatomic_read__nocheck(&tb->prof.unchained);
+    TBProfile p = {
+        .pc = tb->pc,
+        .phys_pc = tb_page_addr0(tb),
+        .icount = tb->icount,
+        .host_size = tb->tc.size,
+        .exec = qatomic_read__nocheck(&tb->prof.exec),
+        .chained = goto_tb > unchained ? goto_tb - unchained : 0,
+        .lookup = qatomic_read__nocheck(&tb->prof.lookup),
+        .exit = qatomic_read__nocheck(&tb->prof.exit),
+    };
+
+    if (p.exec) {
+        g_array_append_val(profs, p);
+    }
+    return false;
+}
+
+static gint tb_profile_cmp(gconstpointer a, gconstpointer b)
+{
+    const TBProfile *pa = a, *pb = b;
+
+    return pa->exec < pb->exec ? 1 : pa->exec > pb->exec ? -1 : 0;
+}
+
+HumanReadableText *qmp_x_query_tb_profile(bool has_count, int64_t count,
+                                          Error **errp)
+{
+    g_autoptr(GString) buf = g_string_new("");
+    g_autoptr(GArray) profs = NULL;
+    uint64_t total = 0;
+    guint i;
+
+    if (!tcg_enabled()) {
+        error_setg(errp, "TB profile is only available with accel=tcg");
+        return NULL;
+    }
+    if (!tb_profile) {
+        g_string_append_printf(buf, "TB profiling is disabled, "
+                               "use -accel tcg,tb-profile=on\n");
+        return human_readable_text_from_str(buf);
+    }
+    if (!has_count) {
+        count = 20;
+    } else if (count < 1) {
+        error_setg(errp, "'count' must be positive");
+        return NULL;
+    }
+
+    profs = g_array_new(false, false, sizeof(TBProfile));
+    tcg_tb_foreach(tb_profile_iter, profs);
+    g_array_sort(profs, tb_profile_cmp);
+    for (i = 0; i < profs->len; i++) {
+        total += g_array_index(profs, TBProfile, i).exec;
+    }
+
+    g_string_append_printf(buf, "%u TBs executed, %" PRIu64 " executions\n",
+                           profs->len, total);
+    g_string_append_printf(buf, "%-18s %-18s %5s %12s %6s %12s %12s %12s "
+                           "%9s\n", "pc", "phys", "insns", "exec", "%",
+                           "chained", "lookup", "exit", "host/insn");
+    for (i = 0; i < profs->len && i < count; i++) {
+        TBProfile *p = &g_array_index(profs, TBProfile, i);
+
+        g_string_append_printf(buf, "0x%016" VADDR_PRIx " 0x%016" PRIx64
+                               " %5u %12" PRIu64 " %6.2f %12" PRIu64
+                               " %12" PRIu64 " %12" PRIu64 " %9.1f\n",
+                               p->pc, (uint64_t)p->phys_pc, p->icount,
+                               p->exec, (double)p->exec * 100 / total,
+                               p->chained, p->lookup, p->exit,
+                               p->icount ? (double)p->host_size / p->icount
+                                         : 0);
+    }
+
+    return human_readable_text_from_str(buf);
+}
+
+static HumanReadableText *qmp_x_query_tb_profile_hmp(Error **errp)
+{
+    return qmp_x_query_tb_profile(false, 0, errp);
+}
+
 static void hmp_tcg_register(void)
 {
     monitor_register_hmp_info_hrt("jit", qmp_x_query_jit);
     monitor_register_hmp_info_hrt("opcount", qmp_x_query_opcount);
+    monitor_register_hmp_info_hrt("tb-profile", qmp_x_query_tb_profile_hmp);
 }
 
 type_init(hmp_tcg_register);
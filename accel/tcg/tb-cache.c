@@ -0,0 +1,286 @@
+/*
+ * Persistent translation cache hints.
+ *
+ * Remember which blocks were translated on each guest physical page and
+ * save that to a file on exit.  On the next run, the first time one of
+ * those pages misses in the TB lookup, all the blocks recorded for it
+ * with the same cpu state are translated in one go, provided the page
+ * still hashes to the same value.
+ *
+ * The generated host code itself is not saved: it embeds host addresses
+ * (helpers, the TB itself, the epilogue) without relocation records.
+ * Since the blocks are always translated from the current guest memory,
+ * a stale hint only costs a wasted translation.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "qemu/crc32c.h"
+#include "qemu/error-report.h"
+#include "qemu/notify.h"
+#include "qemu/thread.h"
+#include "sysemu/sysemu.h"
+#include "exec/exec-all.h"
+#include "tb-cache.h"
+#include "internal-target.h"
+
+#define TB_CACHE_MAGIC      "QEMUTBC1"
+#define TB_CACHE_NAME_LEN   16
+#define TB_CACHE_HDR_SIZE   (8 + TB_CACHE_NAME_LEN + 4)
+#define TB_CACHE_PAGE_SIZE  (8 + 4 + 4)
+#define TB_CACHE_ENT_SIZE   (8 + 4 + 4 + 4)
+
+/* Blocks translated with these are specific to the moment they ran. */
+#define TB_CACHE_CF_SKIP    (CF_COUNT_MASK | CF_SINGLE_STEP | CF_NOIRQ | \
+                             CF_INVALID | CF_MEMI_ONLY)
+
+typedef struct TBCacheEntry {
+    uint64_t cs_base;
+    uint32_t flags;
+    uint32_t cflags;
+    uint32_t offset;
+    /* Loaded from the file and not translated in this run yet. */
+    bool pending;
+} TBCacheEntry;
+
+typedef struct TBCachePage {
+    uint64_t addr;
+    uint32_t hash;
+    /* The hash of the loaded entries has been checked in this run. */
+    bool checked;
+    GArray *entries;
+} TBCachePage;
+
+static struct {
+    char *path;
+    QemuMutex lock;
+    GHashTable *pages;
+    Notifier exit_notifier;
+} tb_cache;
+
+static uint32_t tb_cache_hash(const void *host)
+{
+    return crc32c(0xffffffff, host, TARGET_PAGE_SIZE);
+}
+
+static void tb_cache_page_free(gpointer data)
+{
+    TBCachePage *page = data;
+
+    g_array_free(page->entries, true);
+    g_free(page);
+}
+
+static TBCachePage *tb_cache_page(uint64_t addr)
+{
+    TBCachePage *page = g_hash_table_lookup(tb_cache.pages, &addr);
+
+    if (!page) {
+        page = g_new0(TBCachePage, 1);
+        page->addr = addr;
+        page->checked = true;
+        page->entries = g_array_new(false, false, sizeof(TBCacheEntry));
+        g_hash_table_insert(tb_cache.pages, &page->addr, page);
+    }
+    return page;
+}
+
+static bool tb_cache_load(const char *path)
+{
+    g_autofree char *buf = NULL;
+    g_autoptr(GError) err = NULL;
+    char name[TB_CACHE_NAME_LEN] = TARGET_NAME;
+    const char *p, *end;
+    gsize len;
+
+    if (!g_file_get_contents(path, &buf, &len, &err)) {
+        if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            warn_report("tb-cache: %s", err->message);
+        }
+        return false;
+    }
+
+    p = buf;
+    end = buf + len;
+    if (len < TB_CACHE_HDR_SIZE ||
+        memcmp(p, TB_CACHE_MAGIC, 8) ||
+        memcmp(p + 8, name, TB_CACHE_NAME_LEN) ||
+        ldl_le_p(p + 8 + TB_CACHE_NAME_LEN) != TARGET_PAGE_BITS) {
+        warn_report("tb-cache: %s was not written for this target, ignoring",
+                    path);
+        return false;
+    }
+    p += TB_CACHE_HDR_SIZE;
+
+    while (p < end) {
+        TBCachePage *page;
+        uint32_t i, n;
+
+        if (end - p < TB_CACHE_PAGE_SIZE) {
+            goto truncated;
+        }
+        page = tb_cache_page(ldq_le_p(p));
+        page->hash = ldl_le_p(p + 8);
+        page->checked = false;
+        n = ldl_le_p(p + 12);
+        p += TB_CACHE_PAGE_SIZE;
+
+        if ((end - p) / TB_CACHE_ENT_SIZE < n) {
+            goto truncated;
+        }
+        for (i = 0; i < n; i++, p += TB_CACHE_ENT_SIZE) {
+            TBCacheEntry e = {
+                .cs_base = ldq_le_p(p),
+                .flags = ldl_le_p(p + 8),
+                .cflags = ldl_le_p(p + 12),
+                .offset = ldl_le_p(p + 16),
+                .pending = true,
+            };
+            g_array_append_val(page->entries, e);
+        }
+    }
+    return true;
+
+ truncated:
+    warn_report("tb-cache: %s is truncated, ignoring", path);
+    g_hash_table_remove_all(tb_cache.pages);
+    return false;
+}
+
+static void tb_cache_save(Notifier *n, void *data)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+    g_autoptr(GError) err = NULL;
+    char name[TB_CACHE_NAME_LEN] = TARGET_NAME;
+    uint8_t tmp[TB_CACHE_ENT_SIZE];
+    GHashTableIter iter;
+    TBCachePage *page;
+
+    g_byte_array_append(buf, (const uint8_t *)TB_CACHE_MAGIC, 8);
+    g_byte_array_append(buf, (const uint8_t *)name, TB_CACHE_NAME_LEN);
+    stl_le_p(tmp, TARGET_PAGE_BITS);
+    g_byte_array_append(buf, tmp, 4);
+
+    qemu_mutex_lock(&tb_cache.lock);
+    g_hash_table_iter_init(&iter, tb_cache.pages);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&page)) {
+        guint i;
+
+        if (!page->entries->len) {
+            continue;
+        }
+        stq_le_p(tmp, page->addr);
+        stl_le_p(tmp + 8, page->hash);
+        stl_le_p(tmp + 12, page->entries->len);
+        g_byte_array_append(buf, tmp, TB_CACHE_PAGE_SIZE);
+
+        for (i = 0; i < page->entries->len; i++) {
+            TBCacheEntry *e = &g_array_index(page->entries, TBCacheEntry, i);
+
+            stq_le_p(tmp, e->cs_base);
+            stl_le_p(tmp + 8, e->flags);
+            stl_le_p(tmp + 12, e->cflags);
+            stl_le_p(tmp + 16, e->offset);
+            g_byte_array_append(buf, tmp, TB_CACHE_ENT_SIZE);
+        }
+    }
+    qemu_mutex_unlock(&tb_cache.lock);
+
+    if (!g_file_set_contents(tb_cache.path, (const char *)buf->data,
+                             buf->len, &err)) {
+        warn_report("tb-cache: %s", err->message);
+    }
+}
+
+void tb_cache_init(const char *path)
+{
+    qemu_mutex_init(&tb_cache.lock);
+    tb_cache.path = g_strdup(path);
+    tb_cache.pages = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                           NULL, tb_cache_page_free);
+    tb_cache_load(path);
+
+    tb_cache.exit_notifier.notify = tb_cache_save;
+    qemu_add_exit_notifier(&tb_cache.exit_notifier);
+}
+
+void tb_cache_record(CPUState *cpu, TranslationBlock *tb, vaddr pc)
+{
+    tb_page_addr_t phys_pc = tb_page_addr0(tb);
+    uint32_t cflags = tb_cflags(tb);
+    uint32_t offset = pc & ~TARGET_PAGE_MASK;
+    g_autoptr(GArray) todo = NULL;
+    TBCachePage *page;
+    bool found = false;
+    void *host;
+    guint i;
+
+    if (!tb_cache.pages || phys_pc == -1 || tb_page_addr1(tb) != -1 ||
+        (cflags & TB_CACHE_CF_SKIP)) {
+        return;
+    }
+    /* Already filled in by the translation of @tb, so this can't fault. */
+    get_page_addr_code_hostp(cpu_env(cpu), pc, &host);
+    host -= offset;
+
+    qemu_mutex_lock(&tb_cache.lock);
+    page = tb_cache_page(phys_pc & TARGET_PAGE_MASK);
+
+    if (!page->checked) {
+        page->checked = true;
+        if (page->hash != tb_cache_hash(host)) {
+            g_array_set_size(page->entries, 0);
+        }
+    }
+
+    for (i = 0; i < page->entries->len; i++) {
+        TBCacheEntry *e = &g_array_index(page->entries, TBCacheEntry, i);
+
+        if (e->cs_base != tb->cs_base || e->flags != tb->flags ||
+            e->cflags != cflags) {
+            continue;
+        }
+        if (e->offset == offset) {
+            e->pending = false;
+            found = true;
+        } else if (e->pending) {
+            if (!todo) {
+                todo = g_array_new(false, false, sizeof(uint32_t));
+            }
+            e->pending = false;
+            g_array_append_val(todo, e->offset);
+        }
+    }
+    if (!found) {
+        TBCacheEntry e = {
+            .cs_base = tb->cs_base,
+            .flags = tb->flags,
+            .cflags = cflags,
+            .offset = offset,
+        };
+        g_array_append_val(page->entries, e);
+        /* Hash the contents the new entry was translated from. */
+        page->hash = tb_cache_hash(host);
+    }
+    qemu_mutex_unlock(&tb_cache.lock);
+
+    if (!todo) {
+        return;
+    }
+    for (i = 0; i < todo->len; i++) {
+        uint32_t toff = g_array_index(todo, uint32_t, i);
+        vaddr tpc = (pc & TARGET_PAGE_MASK) | toff;
+
+        /*
+         * A stale hint may run off the end of the page, whose lookup
+         * could fault: give up on those rather than fill the TLB.
+         */
+        if (!tb_htable_lookup(cpu, tpc, tb->cs_base, tb->flags, cflags)) {
+            tb_gen_code_background(cpu, tpc, tb->cs_base, tb->flags, cflags,
+                                   (phys_pc & TARGET_PAGE_MASK) | toff,
+                                   host + toff);
+        }
+    }
+}
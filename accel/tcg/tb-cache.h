@@ -0,0 +1,26 @@
+/*
+ * Persistent translation cache hints.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef ACCEL_TCG_TB_CACHE_H
+#define ACCEL_TCG_TB_CACHE_H
+
+#ifndef CONFIG_USER_ONLY
+/* Load the hints from @path, and save them back there on exit. */
+void tb_cache_init(const char *path);
+
+/*
+ * Note that @tb was translated for @pc after a lookup miss, and translate
+ * ahead the blocks that the previous runs translated on the same page.
+ */
+void tb_cache_record(CPUState *cpu, TranslationBlock *tb, vaddr pc);
+#else
+static inline void tb_cache_record(CPUState *cpu, TranslationBlock *tb,
+                                   vaddr pc)
+{
+}
+#endif
+
+#endif
@@ -35,6 +35,8 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    unsigned tb_reclaim_count;
+    unsigned tb_smc_false_share_count;
 };
 
 extern TBContext tb_ctx;
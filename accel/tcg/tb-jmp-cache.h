@@ -9,20 +9,68 @@
 #ifndef ACCEL_TCG_TB_JMP_CACHE_H
 #define ACCEL_TCG_TB_JMP_CACHE_H
 
-#define TB_JMP_CACHE_BITS 12
-#define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+/*
+ * The number of entries in use is 1 << 'bits', which the owning vCPU
+ * adapts to the miss rate between TB_JMP_CACHE_MIN_BITS and
+ * TB_JMP_CACHE_MAX_BITS, starting at TB_JMP_CACHE_BITS.  The array is
+ * allocated for the maximum; only the entries in use are ever set.
+ */
+#define TB_JMP_CACHE_BITS       12
+#define TB_JMP_CACHE_MIN_BITS   10
+#define TB_JMP_CACHE_MAX_BITS   16
+
+/* Entries recently evicted from the array, searched before the qht. */
+#define TB_JMP_VICTIM_SIZE      8
+
+/* Inline caches for indirect branches, see translator_goto_ptr_cached(). */
+#define TB_IND_CACHE_SIZE       1024
+#define TB_RAS_SIZE             16
+
+/*
+ * The last target of the branch at @site for @key.  Only valid while
+ * @gen matches the ind_gen of the CPUJumpCache, which is bumped whenever
+ * the jump cache would drop entries.
+ */
+typedef struct TBIndirectEntry {
+    uint64_t key;
+    const void *site;
+    const void *host;
+    uint32_t gen;
+} TBIndirectEntry;
 
 /*
- * Accessed in parallel; all accesses to 'tb' must be atomic.
+ * Accessed in parallel; all accesses to 'tb' and 'bits' must be atomic.
  * For CF_PCREL, accesses to 'pc' must be protected by a
- * load_acquire/store_release to 'tb'.
+ * load_acquire/store_release to 'tb'.  'pc' is always set in the
+ * victim cache.
  */
 struct CPUJumpCache {
     struct rcu_head rcu;
+    unsigned bits;
+    unsigned victim_next;
+    /* Reported by "info jit". */
+    size_t lookups;
+    size_t victim_hits;
+    size_t htable_hits;
+    size_t htable_misses;
+    /* The counters when the current sizing window started. */
+    size_t window_lookups;
+    size_t window_misses;
+    bool settling;
+    struct {
+        TranslationBlock *tb;
+        vaddr pc;
+    } victim[TB_JMP_VICTIM_SIZE];
+    /* Accessed by the owning vCPU only, except for 'ind_gen'. */
+    uint32_t ind_gen;
+    uint32_t ras_top;
+    /* Return stack of the ind[] entries of the call sites. */
+    uint32_t ras[TB_RAS_SIZE];
+    TBIndirectEntry ind[TB_IND_CACHE_SIZE];
     struct {
         TranslationBlock *tb;
         vaddr pc;
-    } array[TB_JMP_CACHE_SIZE];
+    } array[1 << TB_JMP_CACHE_MAX_BITS];
 };
 
 #endif /* ACCEL_TCG_TB_JMP_CACHE_H */
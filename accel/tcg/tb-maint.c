@@ -18,6 +18,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/bitmap.h"
 #include "qemu/interval-tree.h"
 #include "qemu/qtree.h"
 #include "exec/cputlb.h"
@@ -29,6 +30,7 @@
 #include "tcg/tcg.h"
 #include "tb-hash.h"
 #include "tb-context.h"
+#include "tb-spec.h"
 #include "internal-common.h"
 #include "internal-target.h"
 
@@ -50,7 +52,8 @@ static bool tb_cmp(const void *ap, const void *bp)
     return (a->pc == b->pc &&
             a->cs_base == b->cs_base &&
             a->flags == b->flags &&
-            (tb_cflags(a) & ~CF_INVALID) == (tb_cflags(b) & ~CF_INVALID) &&
+            (tb_cflags(a) & ~(CF_INVALID | CF_TRACE)) ==
+            (tb_cflags(b) & ~(CF_INVALID | CF_TRACE)) &&
             tb_page_addr0(a) == tb_page_addr0(b) &&
             tb_page_addr1(a) == tb_page_addr1(b));
 }
@@ -178,10 +181,19 @@ static int v_l2_levels;
 
 static void *l1_map[V_L1_MAX_SIZE];
 
+/*
+ * Number of writes to a code page before we build its code bitmap, and
+ * stop invalidating on writes that don't touch the code on the page.
+ */
+#define SMC_BITMAP_USE_THRESHOLD 10
+
 struct PageDesc {
     QemuSpin lock;
     /* list of TBs intersecting this ram page */
     uintptr_t first_tb;
+    /* one bit per byte of the page that is covered by a TB, or NULL */
+    unsigned long *code_bitmap;
+    unsigned int code_write_count;
 };
 
 void page_table_config_init(void)
@@ -649,6 +661,40 @@ static void page_collection_unlock(struct page_collection *set)
     g_free(set);
 }
 
+/* The set of TBs on @pd has changed, drop its code bitmap. */
+static void invalidate_page_bitmap(PageDesc *pd)
+{
+    assert_page_locked(pd);
+    g_free(pd->code_bitmap);
+    pd->code_bitmap = NULL;
+    pd->code_write_count = 0;
+}
+
+/* Mark the bytes of page @pd that are covered by a TB. */
+static void build_page_bitmap(PageDesc *pd)
+{
+    TranslationBlock *tb;
+    PageForEachNext n;
+
+    assert_page_locked(pd);
+    pd->code_bitmap = bitmap_new(TARGET_PAGE_SIZE);
+
+    PAGE_FOR_EACH_TB(unused, unused, pd, tb, n) {
+        tb_page_addr_t tb_start, tb_last;
+
+        /* NOTE: this is subtle as a TB may span two physical pages */
+        tb_start = tb_page_addr0(tb) & ~TARGET_PAGE_MASK;
+        tb_last = tb_start + tb->size - 1;
+        if (n == 0) {
+            tb_last = MIN(tb_last, ~TARGET_PAGE_MASK);
+        } else {
+            tb_start = 0;
+            tb_last &= ~TARGET_PAGE_MASK;
+        }
+        bitmap_set(pd->code_bitmap, tb_start, tb_last - tb_start + 1);
+    }
+}
+
 /* Set to NULL all the 'first_tb' fields in all PageDescs. */
 static void tb_remove_all_1(int level, void **lp)
 {
@@ -663,6 +709,7 @@ static void tb_remove_all_1(int level, void **lp)
         for (i = 0; i < V_L2_SIZE; ++i) {
             page_lock(&pd[i]);
             pd[i].first_tb = (uintptr_t)NULL;
+            invalidate_page_bitmap(&pd[i]);
             page_unlock(&pd[i]);
         }
     } else {
@@ -696,6 +743,7 @@ static void tb_page_add(PageDesc *p, TranslationBlock *tb, unsigned int n)
     tb->page_next[n] = p->first_tb;
     page_already_protected = p->first_tb != 0;
     p->first_tb = (uintptr_t)tb | n;
+    invalidate_page_bitmap(p);
 
     /*
      * If some code is already present, then the pages are already
@@ -732,6 +780,7 @@ static void tb_page_remove(PageDesc *pd, TranslationBlock *tb)
     PAGE_FOR_EACH_TB(unused, unused, pd, tb1, n1) {
         if (tb1 == tb) {
             *pprev = tb1->page_next[n1];
+            invalidate_page_bitmap(pd);
             return;
         }
         pprev = &tb1->page_next[n1];
@@ -759,6 +808,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 {
     bool did_flush = false;
 
+    tb_spec_pause();
     mmap_lock();
     /* If it is already been done on request of another CPU, just retry. */
     if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
@@ -779,6 +829,7 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 
 done:
     mmap_unlock();
+    tb_spec_resume();
     if (did_flush) {
         qemu_plugin_flush_cb();
     }
@@ -884,14 +935,21 @@ static void tb_jmp_cache_inval_tb(TranslationBlock *tb)
             tcg_flush_jmp_cache(cpu);
         }
     } else {
-        uint32_t h = tb_jmp_cache_hash_func(tb->pc);
-
         CPU_FOREACH(cpu) {
             CPUJumpCache *jc = cpu->tb_jmp_cache;
+            uint32_t h = tb_jmp_cache_hash_func(tb->pc,
+                                                qatomic_read(&jc->bits));
 
             if (qatomic_read(&jc->array[h].tb) == tb) {
                 qatomic_set(&jc->array[h].tb, NULL);
             }
+            for (int i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+                if (qatomic_read(&jc->victim[i].tb) == tb) {
+                    qatomic_set(&jc->victim[i].tb, NULL);
+                }
+            }
+            /* The inline caches are not indexed by pc. */
+            qatomic_inc(&jc->ind_gen);
         }
     }
 }
@@ -900,8 +958,11 @@ static void tb_jmp_cache_inval_tb(TranslationBlock *tb)
  * In user-mode, call with mmap_lock held.
  * In !user-mode, if @rm_from_page_list is set, call with the TB's pages'
  * locks held.
+ * Leave the jump caches alone if @inval_jmp_cache is not set; the caller
+ * must then flush them.
  */
-static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
+static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list,
+                                  bool inval_jmp_cache)
 {
     uint32_t h;
     tb_page_addr_t phys_pc;
@@ -917,7 +978,7 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     /* remove the TB from the hash list */
     phys_pc = tb_page_addr0(tb);
     h = tb_hash_func(phys_pc, tb->pc,
-                     tb->flags, tb->cs_base, orig_cflags);
+                     tb->flags, tb->cs_base, orig_cflags & ~CF_TRACE);
     if (!qht_remove(&tb_ctx.htable, tb, h)) {
         return;
     }
@@ -928,7 +989,9 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    tb_jmp_cache_inval_tb(tb);
+    if (inval_jmp_cache) {
+        tb_jmp_cache_inval_tb(tb);
+    }
 
     /* suppress this TB from the two jump lists */
     tb_remove_from_jmp_list(tb, 0);
@@ -944,7 +1007,7 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
 static void tb_phys_invalidate__locked(TranslationBlock *tb)
 {
     qemu_thread_jit_write();
-    do_tb_phys_invalidate(tb, true);
+    do_tb_phys_invalidate(tb, true, true);
     qemu_thread_jit_execute();
 }
 
@@ -956,10 +1019,68 @@ void tb_phys_invalidate(TranslationBlock *tb, tb_page_addr_t page_addr)
 {
     if (page_addr == -1 && tb_page_addr0(tb) != -1) {
         tb_lock_pages(tb);
-        do_tb_phys_invalidate(tb, true);
+        do_tb_phys_invalidate(tb, true, true);
         tb_unlock_pages(tb);
     } else {
-        do_tb_phys_invalidate(tb, false);
+        do_tb_phys_invalidate(tb, false, true);
+    }
+}
+
+/* Unlink a TB whose region is about to be handed out again. */
+static void tb_reclaim_one(gpointer data, gpointer user_data)
+{
+    TranslationBlock *tb = data;
+
+    tb_lock_pages(tb);
+    do_tb_phys_invalidate(tb, true, false);
+    tb_unlock_pages(tb);
+}
+
+static void do_tb_reclaim(CPUState *cpu, run_on_cpu_data tb_flush_count)
+{
+    CPUState *other;
+    bool reclaimed;
+
+    tb_spec_pause();
+    mmap_lock();
+    /* A flush since the request has made room already. */
+    if (tb_ctx.tb_flush_count != tb_flush_count.host_int) {
+        mmap_unlock();
+        tb_spec_resume();
+        return;
+    }
+
+    qemu_thread_jit_write();
+    reclaimed = tcg_region_reclaim(tb_reclaim_one, NULL);
+    qemu_thread_jit_execute();
+    if (reclaimed) {
+        CPU_FOREACH(other) {
+            tcg_flush_jmp_cache(other);
+        }
+        qatomic_inc(&tb_ctx.tb_reclaim_count);
+    }
+    mmap_unlock();
+    tb_spec_resume();
+
+    if (!reclaimed) {
+        do_tb_flush(cpu, tb_flush_count);
+    }
+}
+
+/*
+ * Make room in the code buffer once tcg_tb_alloc() has failed, by
+ * throwing away the oldest translations only.  Like tb_flush(), this
+ * runs in an exclusive context.
+ */
+void tb_reclaim(CPUState *cpu)
+{
+    unsigned tb_flush_count = qatomic_read(&tb_ctx.tb_flush_count);
+
+    if (cpu_in_serial_context(cpu)) {
+        do_tb_reclaim(cpu, RUN_ON_CPU_HOST_INT(tb_flush_count));
+    } else {
+        async_safe_run_on_cpu(cpu, do_tb_reclaim,
+                              RUN_ON_CPU_HOST_INT(tb_flush_count));
     }
 }
 
@@ -984,7 +1105,7 @@ TranslationBlock *tb_link_page(TranslationBlock *tb)
 
     /* add in the hash table */
     h = tb_hash_func(tb_page_addr0(tb), tb->pc,
-                     tb->flags, tb->cs_base, tb->cflags);
+                     tb->flags, tb->cs_base, tb->cflags & ~CF_TRACE);
     qht_insert(&tb_ctx.htable, tb, h, &existing_tb);
 
     /* remove TB from the page(s) if we couldn't insert it */
@@ -1229,6 +1350,19 @@ static void tb_invalidate_phys_page_fast__locked(struct page_collection *pages,
     }
 
     assert_page_locked(p);
+    if (!p->code_bitmap &&
+        ++p->code_write_count >= SMC_BITMAP_USE_THRESHOLD) {
+        build_page_bitmap(p);
+    }
+    if (p->code_bitmap) {
+        unsigned int nr = start & ~TARGET_PAGE_MASK;
+
+        /* The write only hits data sharing the page with code. */
+        if (find_next_bit(p->code_bitmap, nr + len, nr) >= nr + len) {
+            qatomic_inc(&tb_ctx.tb_smc_false_share_count);
+            return;
+        }
+    }
     tb_invalidate_phys_page_range__locked(pages, p, start, start + len - 1, ra);
 }
 
@@ -0,0 +1,186 @@
+/*
+ * Speculative background translation.
+ *
+ * When a vCPU misses in the TB lookup and translates a new block, queue
+ * the direct branch targets of that block -- which include the fall
+ * through into the next page of straight-line code -- and translate them
+ * on a separate thread with the same cpu state.  The results are linked
+ * into the hash table by tb_link_page() like any other TB, so the vCPU
+ * finds them already translated when it gets there.
+ *
+ * Translation depends only on the state captured in the TB flags, so the
+ * background thread may use the vCPU's static configuration.  It must not
+ * touch the vCPU's TLB though: the pages are looked up by the vCPU when
+ * queueing, and a block that runs into a second page is dropped.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/rcu.h"
+#include "qemu/thread.h"
+#include "exec/exec-all.h"
+#include "tcg/startup.h"
+#include "tb-spec.h"
+#include "internal-target.h"
+
+#define TB_SPEC_QUEUE_LEN   64
+
+/* Only speculate for the cflags a plain TB lookup would use. */
+#define TB_SPEC_CF_SKIP     (CF_COUNT_MASK | CF_SINGLE_STEP | CF_NOIRQ | \
+                             CF_INVALID | CF_MEMI_ONLY | CF_TRACE)
+
+typedef struct TBSpecRequest {
+    CPUState *cpu;
+    vaddr pc;
+    uint64_t cs_base;
+    uint32_t flags;
+    uint32_t cflags;
+    tb_page_addr_t phys_pc;
+    /* Host address of the page of @phys_pc when queued. */
+    void *host_page;
+} TBSpecRequest;
+
+static struct {
+    bool enabled;
+    QemuThread thread;
+    QemuMutex lock;
+    QemuCond cond;
+    TBSpecRequest queue[TB_SPEC_QUEUE_LEN];
+    unsigned head;
+    unsigned len;
+    /* A request is being translated, with @lock released. */
+    bool busy;
+    unsigned paused;
+} tb_spec;
+
+static void tb_spec_translate(TBSpecRequest *req)
+{
+    tb_page_addr_t page = req->phys_pc & TARGET_PAGE_MASK;
+
+    RCU_READ_LOCK_GUARD();
+
+    /* The RAM may have gone away since the request was queued. */
+    if (qemu_ram_addr_from_host(req->host_page) != page) {
+        return;
+    }
+    tb_gen_code_background(req->cpu, req->pc, req->cs_base, req->flags,
+                           req->cflags, req->phys_pc,
+                           req->host_page + (req->pc & ~TARGET_PAGE_MASK));
+}
+
+static void *tb_spec_thread(void *opaque)
+{
+    bool registered = false;
+
+    rcu_register_thread();
+
+    qemu_mutex_lock(&tb_spec.lock);
+    while (true) {
+        TBSpecRequest req;
+
+        while (!tb_spec.len || tb_spec.paused) {
+            qemu_cond_wait(&tb_spec.cond, &tb_spec.lock);
+        }
+        req = tb_spec.queue[tb_spec.head];
+        tb_spec.head = (tb_spec.head + 1) % TB_SPEC_QUEUE_LEN;
+        tb_spec.len--;
+        tb_spec.busy = true;
+        qemu_mutex_unlock(&tb_spec.lock);
+
+        /* Not before the target has created its TCG globals. */
+        if (!registered) {
+            tcg_register_thread();
+            registered = true;
+        }
+        tb_spec_translate(&req);
+
+        qemu_mutex_lock(&tb_spec.lock);
+        tb_spec.busy = false;
+        qemu_cond_broadcast(&tb_spec.cond);
+    }
+    return NULL;
+}
+
+void tb_spec_init(void)
+{
+    qemu_mutex_init(&tb_spec.lock);
+    qemu_cond_init(&tb_spec.cond);
+    qemu_thread_create(&tb_spec.thread, "TCG spec", tb_spec_thread,
+                       NULL, QEMU_THREAD_DETACHED);
+    tb_spec.enabled = true;
+}
+
+void tb_spec_queue(CPUState *cpu, TranslationBlock *tb)
+{
+    CPUArchState *env = cpu_env(cpu);
+    uint32_t cflags = tb_cflags(tb);
+    const vaddr *dests;
+    int i, n;
+
+    if (!tb_spec.enabled || tb_page_addr0(tb) == -1 ||
+        (cflags & TB_SPEC_CF_SKIP) ||
+        test_bit(QEMU_PLUGIN_EV_VCPU_TB_TRANS, cpu->plugin_mask)) {
+        return;
+    }
+
+    n = translator_exits(&dests);
+    for (i = 0; i < n; i++) {
+        CPUTLBEntryFull *full;
+        void *host;
+        int flags;
+
+        /* Look the page up without raising a guest fault. */
+        flags = probe_access_full_mmu(env, dests[i], 1, MMU_INST_FETCH,
+                                      cpu_mmu_index(env, true), &host, &full);
+        if ((flags & TLB_INVALID_MASK) || host == NULL ||
+            full->lg_page_size < TARGET_PAGE_BITS) {
+            continue;
+        }
+        if (tb_htable_lookup(cpu, dests[i], tb->cs_base, tb->flags, cflags)) {
+            continue;
+        }
+
+        qemu_mutex_lock(&tb_spec.lock);
+        if (tb_spec.len < TB_SPEC_QUEUE_LEN) {
+            unsigned idx = (tb_spec.head + tb_spec.len) % TB_SPEC_QUEUE_LEN;
+
+            tb_spec.queue[idx] = (TBSpecRequest) {
+                .cpu = cpu,
+                .pc = dests[i],
+                .cs_base = tb->cs_base,
+                .flags = tb->flags,
+                .cflags = cflags,
+                .phys_pc = qemu_ram_addr_from_host_nofail(host),
+                .host_page = host - (dests[i] & ~TARGET_PAGE_MASK),
+            };
+            tb_spec.len++;
+            qemu_cond_broadcast(&tb_spec.cond);
+        }
+        qemu_mutex_unlock(&tb_spec.lock);
+    }
+}
+
+void tb_spec_pause(void)
+{
+    if (!tb_spec.enabled) {
+        return;
+    }
+    qemu_mutex_lock(&tb_spec.lock);
+    tb_spec.paused++;
+    while (tb_spec.busy) {
+        qemu_cond_wait(&tb_spec.cond, &tb_spec.lock);
+    }
+    qemu_mutex_unlock(&tb_spec.lock);
+}
+
+void tb_spec_resume(void)
+{
+    if (!tb_spec.enabled) {
+        return;
+    }
+    qemu_mutex_lock(&tb_spec.lock);
+    tb_spec.paused--;
+    qemu_cond_broadcast(&tb_spec.cond);
+    qemu_mutex_unlock(&tb_spec.lock);
+}
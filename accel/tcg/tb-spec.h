@@ -0,0 +1,37 @@
+/*
+ * Speculative background translation.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef ACCEL_TCG_TB_SPEC_H
+#define ACCEL_TCG_TB_SPEC_H
+
+#ifndef CONFIG_USER_ONLY
+/* Set up the background translation thread. */
+void tb_spec_init(void);
+
+/*
+ * Queue the direct branch targets of @tb, which @cpu has just translated,
+ * for translation in the background.
+ */
+void tb_spec_queue(CPUState *cpu, TranslationBlock *tb);
+
+/* Wait for and hold off background translation, e.g. across a tb_flush. */
+void tb_spec_pause(void);
+void tb_spec_resume(void);
+#else
+static inline void tb_spec_queue(CPUState *cpu, TranslationBlock *tb)
+{
+}
+
+static inline void tb_spec_pause(void)
+{
+}
+
+static inline void tb_spec_resume(void)
+{
+}
+#endif
+
+#endif
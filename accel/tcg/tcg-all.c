@@ -39,6 +39,8 @@
 #include "hw/boards.h"
 #endif
 #include "internal-target.h"
+#include "tb-cache.h"
+#include "tb-spec.h"
 
 struct TCGState {
     AccelState parent_obj;
@@ -47,6 +49,10 @@ struct TCGState {
     bool one_insn_per_tb;
     int splitwx_enabled;
     unsigned long tb_size;
+    char *tb_cache;
+    uint32_t tb_hot_threshold;
+    bool spec_translate;
+    bool tb_profile;
 };
 typedef struct TCGState TCGState;
 
@@ -99,22 +105,30 @@ static void tcg_accel_instance_init(Object *obj)
 
 bool mttcg_enabled;
 bool one_insn_per_tb;
+uint32_t tb_hot_threshold;
+bool tb_profile;
 
 static int tcg_init_machine(MachineState *ms)
 {
     TCGState *s = TCG_STATE(current_accel());
 #ifdef CONFIG_USER_ONLY
-    unsigned max_cpus = 1;
+    unsigned max_threads = 1;
 #else
-    unsigned max_cpus = ms->smp.max_cpus;
+    unsigned max_threads = s->mttcg_enabled ? ms->smp.max_cpus : 1;
+
+    if (s->spec_translate) {
+        max_threads++;
+    }
 #endif
 
     tcg_allowed = true;
     mttcg_enabled = s->mttcg_enabled;
+    tb_hot_threshold = s->tb_hot_threshold;
+    tb_profile = s->tb_profile;
 
     page_init();
     tb_htable_init();
-    tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_cpus);
+    tcg_init(s->tb_size * MiB, s->splitwx_enabled, max_threads);
 
 #if defined(CONFIG_SOFTMMU)
     /*
@@ -124,6 +138,15 @@ static int tcg_init_machine(MachineState *ms)
     tcg_prologue_init();
 #endif
 
+#ifndef CONFIG_USER_ONLY
+    if (s->tb_cache) {
+        tb_cache_init(s->tb_cache);
+    }
+    if (s->spec_translate) {
+        tb_spec_init();
+    }
+#endif
+
     return 0;
 }
 
@@ -181,6 +204,73 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_tb_hot_threshold(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value = s->tb_hot_threshold;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_tb_hot_threshold(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value > INT32_MAX) {
+        error_setg(errp, "tb-hot-threshold must be at most %d", INT32_MAX);
+        return;
+    }
+
+    s->tb_hot_threshold = value;
+}
+
+static char *tcg_get_tb_cache(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    return g_strdup(s->tb_cache);
+}
+
+static void tcg_set_tb_cache(Object *obj, const char *value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    g_free(s->tb_cache);
+    s->tb_cache = g_strdup(value);
+}
+
+static bool tcg_get_spec_translate(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->spec_translate;
+}
+
+static void tcg_set_spec_translate(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->spec_translate = value;
+}
+
+static bool tcg_get_tb_profile(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    return s->tb_profile;
+}
+
+static void tcg_set_tb_profile(Object *obj, bool value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+    s->tb_profile = value;
+}
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -242,6 +332,32 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add(oc, "tb-hot-threshold", "int",
+        tcg_get_tb_hot_threshold, tcg_set_tb_hot_threshold,
+        NULL, NULL);
+    object_class_property_set_description(oc, "tb-hot-threshold",
+        "Executions before a block is retranslated as a trace (0 = never)");
+
+#ifndef CONFIG_USER_ONLY
+    object_class_property_add_str(oc, "tb-cache",
+                                  tcg_get_tb_cache,
+                                  tcg_set_tb_cache);
+    object_class_property_set_description(oc, "tb-cache",
+        "File remembering the translated blocks across runs");
+
+    object_class_property_add_bool(oc, "spec-translate",
+                                   tcg_get_spec_translate,
+                                   tcg_set_spec_translate);
+    object_class_property_set_description(oc, "spec-translate",
+        "Translate branch targets ahead in a background thread");
+
+    object_class_property_add_bool(oc, "tb-profile",
+                                   tcg_get_tb_profile,
+                                   tcg_set_tb_profile);
+    object_class_property_set_description(oc, "tb-profile",
+        "Count executions and exits of each translation block");
+#endif
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
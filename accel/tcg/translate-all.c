@@ -284,28 +284,24 @@ static int setjmp_gen_code(CPUArchState *env, TranslationBlock *tb,
     return tcg_gen_code(tcg_ctx, tb, pc);
 }
 
-/* Called with mmap_lock held for user mode emulation.  */
-TranslationBlock *tb_gen_code(CPUState *cpu,
-                              vaddr pc, uint64_t cs_base,
-                              uint32_t flags, int cflags)
+/*
+ * Translate the TB for @pc, whose first page is @phys_pc mapped at
+ * @host_pc.  With @background, the caller may not be the vCPU thread
+ * of @cpu, and gives up with NULL where the vCPU would flush the code
+ * buffer or look up a second page in its TLB.
+ */
+static TranslationBlock *do_tb_gen_code(CPUState *cpu,
+                                        vaddr pc, uint64_t cs_base,
+                                        uint32_t flags, int cflags,
+                                        tb_page_addr_t phys_pc,
+                                        void *host_pc, bool background)
 {
     CPUArchState *env = cpu_env(cpu);
     TranslationBlock *tb, *existing_tb;
-    tb_page_addr_t phys_pc, phys_p2;
+    tb_page_addr_t phys_p2;
     tcg_insn_unit *gen_code_buf;
     int gen_code_size, search_size, max_insns;
     int64_t ti;
-    void *host_pc;
-
-    assert_memory_lock();
-    qemu_thread_jit_write();
-
-    phys_pc = get_page_addr_code_hostp(env, pc, &host_pc);
-
-    if (phys_pc == -1) {
-        /* Generate a one-shot TB with 1 insn in it */
-        cflags = (cflags & ~CF_COUNT_MASK) | 1;
-    }
 
     max_insns = cflags & CF_COUNT_MASK;
     if (max_insns == 0) {
@@ -317,8 +313,11 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     assert_no_pages_locked();
     tb = tcg_tb_alloc(tcg_ctx);
     if (unlikely(!tb)) {
-        /* flush must be done */
-        tb_flush(cpu);
+        if (background) {
+            return NULL;
+        }
+        /* the oldest regions must be reclaimed, or everything flushed */
+        tb_reclaim(cpu);
         mmap_unlock();
         /* Make the execution loop process the flush as soon as possible.  */
         cpu->exception_index = EXCP_INTERRUPT;
@@ -331,10 +330,22 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->cs_base = cs_base;
     tb->flags = flags;
     tb->cflags = cflags;
+    tb->hot_count = tb_hot_threshold;
+    memset(&tb->prof, 0, sizeof(tb->prof));
     tb_set_page_addr0(tb, phys_pc);
     tb_set_page_addr1(tb, -1);
     if (phys_pc != -1) {
         tb_lock_page0(phys_pc);
+#ifdef CONFIG_SOFTMMU
+        /*
+         * The vCPU may be writing to the page while we read it.  Route
+         * its stores through the page lock now, so that any store that
+         * lands during translation invalidates the TB once it is linked.
+         */
+        if (background) {
+            tlb_protect_code(phys_pc & TARGET_PAGE_MASK);
+        }
+#endif
     }
 
     tcg_ctx->gen_tb = tb;
@@ -350,6 +361,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
 #else
     tcg_ctx->guest_mo = TCG_MO_ALL;
 #endif
+    tcg_ctx->tb_profile = tb_profile;
+    translator_set_background(background);
 
  restart_translate:
     trace_translate_block(tb, pc, tb->tc.ptr);
@@ -414,6 +427,17 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                           "Restarting code generation with re-locked pages");
             goto restart_translate;
 
+        case -4:
+            /*
+             * A background translation reached a second page, which
+             * only the vCPU thread can look up.  Drop the TB.
+             */
+            assert(background);
+            tb_unlock_pages(tb);
+            tcg_ctx->gen_tb = NULL;
+            qatomic_set(&tcg_ctx->code_gen_ptr, (void *)tb);
+            return NULL;
+
         default:
             g_assert_not_reached();
         }
@@ -562,6 +586,41 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     return tb;
 }
 
+/* Called with mmap_lock held for user mode emulation.  */
+TranslationBlock *tb_gen_code(CPUState *cpu,
+                              vaddr pc, uint64_t cs_base,
+                              uint32_t flags, int cflags)
+{
+    tb_page_addr_t phys_pc;
+    void *host_pc;
+
+    assert_memory_lock();
+    qemu_thread_jit_write();
+
+    phys_pc = get_page_addr_code_hostp(cpu_env(cpu), pc, &host_pc);
+
+    if (phys_pc == -1) {
+        /* Generate a one-shot TB with 1 insn in it */
+        cflags = (cflags & ~CF_COUNT_MASK) | 1;
+    }
+
+    return do_tb_gen_code(cpu, pc, cs_base, flags, cflags,
+                          phys_pc, host_pc, false);
+}
+
+#ifdef CONFIG_SOFTMMU
+TranslationBlock *tb_gen_code_background(CPUState *cpu,
+                                         vaddr pc, uint64_t cs_base,
+                                         uint32_t flags, int cflags,
+                                         tb_page_addr_t phys_pc,
+                                         void *host_pc)
+{
+    qemu_thread_jit_write();
+    return do_tb_gen_code(cpu, pc, cs_base, flags, cflags,
+                          phys_pc, host_pc, true);
+}
+#endif
+
 /* user-mode: call with mmap_lock held */
 void tb_check_watchpoint(CPUState *cpu, uintptr_t retaddr)
 {
@@ -667,7 +726,11 @@ void tcg_flush_jmp_cache(CPUState *cpu)
         return;
     }
 
-    for (int i = 0; i < TB_JMP_CACHE_SIZE; i++) {
+    for (int i = 0; i < 1 << qatomic_read(&jc->bits); i++) {
         qatomic_set(&jc->array[i].tb, NULL);
     }
+    for (int i = 0; i < TB_JMP_VICTIM_SIZE; i++) {
+        qatomic_set(&jc->victim[i].tb, NULL);
+    }
+    qatomic_inc(&jc->ind_gen);
 }
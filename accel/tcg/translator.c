@@ -10,11 +10,42 @@
 #include "qemu/osdep.h"
 #include "qemu/log.h"
 #include "qemu/error-report.h"
+#include "qemu/xxhash.h"
 #include "exec/exec-all.h"
 #include "exec/translator.h"
 #include "exec/plugin-gen.h"
 #include "tcg/tcg-op-common.h"
 #include "internal-target.h"
+#include "tb-jmp-cache.h"
+
+/* The path for the next CF_TRACE translation, see helper_tb_hot(). */
+static __thread vaddr tb_trace[TB_TRACE_MAX];
+static __thread int tb_trace_len;
+
+void translator_set_trace(const vaddr *pcs, int n)
+{
+    assert(n <= TB_TRACE_MAX);
+    memcpy(tb_trace, pcs, n * sizeof(vaddr));
+    tb_trace_len = n;
+}
+
+/* The goto_tb candidates of the last TB, see translator_use_goto_tb(). */
+static __thread vaddr tb_exits[4];
+static __thread int tb_nb_exits;
+
+int translator_exits(const vaddr **dests)
+{
+    *dests = tb_exits;
+    return tb_nb_exits;
+}
+
+/* Set for tb_gen_code_background(), see tb-spec.c and tb-cache.c. */
+static __thread bool translator_background;
+
+void translator_set_background(bool background)
+{
+    translator_background = background;
+}
 
 static void set_can_do_io(DisasContextBase *db, bool val)
 {
@@ -42,11 +73,42 @@ bool translator_io_start(DisasContextBase *db)
     return true;
 }
 
-static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags)
+/* Blocks translated with these run too rarely, or too briefly, to count. */
+#define TB_HOT_CF_SKIP  (CF_TRACE | CF_COUNT_MASK | CF_USE_ICOUNT | \
+                         CF_SINGLE_STEP | CF_NOIRQ)
+
+static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags,
+                           TCGLabel **hot_label)
 {
     TCGv_i32 count = NULL;
     TCGOp *icount_start_insn = NULL;
 
+    /*
+     * Count down tb->hot_count before any guest state is touched, so
+     * that helper_tb_hot() can simply restart execution from the TB.
+     */
+    if (tb_hot_threshold && !(cflags & TB_HOT_CF_SKIP)) {
+        TCGv_ptr ptr = tcg_constant_ptr(db->tb);
+        TCGv_i32 hot = tcg_temp_new_i32();
+
+        *hot_label = gen_new_label();
+        tcg_gen_ld_i32(hot, ptr, offsetof(TranslationBlock, hot_count));
+        tcg_gen_subi_i32(hot, hot, 1);
+        tcg_gen_st_i32(hot, ptr, offsetof(TranslationBlock, hot_count));
+        tcg_gen_brcondi_i32(TCG_COND_LT, hot, 0, *hot_label);
+    } else {
+        *hot_label = NULL;
+    }
+
+    if (tcg_ctx->tb_profile) {
+        TCGv_ptr ptr = tcg_constant_ptr(db->tb);
+        TCGv_i64 exec = tcg_temp_new_i64();
+
+        tcg_gen_ld_i64(exec, ptr, offsetof(TranslationBlock, prof.exec));
+        tcg_gen_addi_i64(exec, exec, 1);
+        tcg_gen_st_i64(exec, ptr, offsetof(TranslationBlock, prof.exec));
+    }
+
     if ((cflags & CF_USE_ICOUNT) || !(cflags & CF_NOIRQ)) {
         count = tcg_temp_new_i32();
         tcg_gen_ld_i32(count, tcg_env,
@@ -95,7 +157,8 @@ static TCGOp *gen_tb_start(DisasContextBase *db, uint32_t cflags)
 }
 
 static void gen_tb_end(const TranslationBlock *tb, uint32_t cflags,
-                       TCGOp *icount_start_insn, int num_insns)
+                       TCGOp *icount_start_insn, int num_insns,
+                       TCGLabel *hot_label)
 {
     if (cflags & CF_USE_ICOUNT) {
         /*
@@ -110,10 +173,19 @@ static void gen_tb_end(const TranslationBlock *tb, uint32_t cflags,
         gen_set_label(tcg_ctx->exitreq_label);
         tcg_gen_exit_tb(tb, TB_EXIT_REQUESTED);
     }
+
+    if (hot_label) {
+        gen_set_label(hot_label);
+        gen_helper_tb_hot(tcg_env, tcg_constant_ptr(tb));
+    }
 }
 
 bool translator_use_goto_tb(DisasContextBase *db, vaddr dest)
 {
+    if (tb_nb_exits < ARRAY_SIZE(tb_exits)) {
+        tb_exits[tb_nb_exits++] = dest;
+    }
+
     /* Suppress goto_tb if requested. */
     if (tb_cflags(db->tb) & CF_NO_GOTO_TB) {
         return false;
@@ -123,12 +195,139 @@ bool translator_use_goto_tb(DisasContextBase *db, vaddr dest)
     return ((db->pc_first ^ dest) & TARGET_PAGE_MASK) == 0;
 }
 
+bool translator_trace_follow(DisasContextBase *db, vaddr dest)
+{
+    if (db->trace_idx >= db->trace_len ||
+        db->trace[db->trace_idx] != dest ||
+        dest < db->pc_next ||
+        ((db->pc_first ^ dest) & TARGET_PAGE_MASK) != 0) {
+        return false;
+    }
+    db->trace_idx++;
+    return true;
+}
+
+static bool translator_use_ind_cache(DisasContextBase *db)
+{
+    /* Hits don't go through helper_lookup_tb_ptr(), which logs. */
+    return !(tb_cflags(db->tb) & CF_NO_GOTO_PTR) &&
+           !qemu_loglevel_mask(CPU_LOG_TB_CPU | CPU_LOG_EXEC);
+}
+
+/*
+ * The entry of the current insn in the indirect branch caches: that of
+ * the branch itself, or for a call, the one of the return to it.
+ */
+static unsigned translator_ind_index(DisasContextBase *db, bool call)
+{
+    return qemu_xxhash5((uintptr_t)db->tb, db->pc_next, call) &
+           (TB_IND_CACHE_SIZE - 1);
+}
+
+static TCGv_ptr gen_load_jmp_cache(void)
+{
+    TCGv_ptr jc = tcg_temp_new_ptr();
+
+    tcg_gen_ld_ptr(jc, tcg_env,
+                   offsetof(ArchCPU, parent_obj.tb_jmp_cache) -
+                   offsetof(ArchCPU, env));
+    return jc;
+}
+
+/*
+ * Move jc->ras_top for a push or a pop, and return the address to add
+ * to offsetof(CPUJumpCache, ras) for the entry pushed to or popped.
+ */
+static TCGv_ptr gen_ras_slot(TCGv_ptr jc, bool push)
+{
+    TCGv_i32 top = tcg_temp_new_i32();
+    TCGv_i32 next = tcg_temp_new_i32();
+    TCGv_ptr addr = tcg_temp_new_ptr();
+
+    tcg_gen_ld_i32(top, jc, offsetof(CPUJumpCache, ras_top));
+    tcg_gen_addi_i32(next, top, push ? 1 : -1);
+    tcg_gen_andi_i32(next, next, TB_RAS_SIZE - 1);
+    tcg_gen_st_i32(next, jc, offsetof(CPUJumpCache, ras_top));
+
+    QEMU_BUILD_BUG_ON(sizeof_field(CPUJumpCache, ras[0]) != 4);
+    tcg_gen_shli_i32(top, push ? top : next, 2);
+    tcg_gen_ext_i32_ptr(addr, top);
+    tcg_gen_add_ptr(addr, addr, jc);
+    return addr;
+}
+
+void translator_push_return(DisasContextBase *db)
+{
+    TCGv_ptr jc, addr;
+
+    if (!translator_use_ind_cache(db)) {
+        return;
+    }
+    jc = gen_load_jmp_cache();
+    addr = gen_ras_slot(jc, true);
+    tcg_gen_st_i32(tcg_constant_i32(translator_ind_index(db, true)), addr,
+                   offsetof(CPUJumpCache, ras));
+}
+
+void translator_goto_ptr_cached(DisasContextBase *db, TCGv_i64 key, bool ret)
+{
+    TCGLabel *miss;
+    TCGv_ptr jc, slot, host;
+    TCGv_i64 k;
+    TCGv_i32 gen, cur;
+
+    if (!translator_use_ind_cache(db)) {
+        tcg_gen_lookup_and_goto_ptr();
+        return;
+    }
+
+    plugin_gen_disable_mem_helpers();
+    jc = gen_load_jmp_cache();
+    slot = tcg_temp_new_ptr();
+    if (ret) {
+        /* Pop the entry of the call site. */
+        TCGv_ptr addr = gen_ras_slot(jc, false);
+        TCGv_i32 idx = tcg_temp_new_i32();
+
+        tcg_gen_ld_i32(idx, addr, offsetof(CPUJumpCache, ras));
+        tcg_gen_muli_i32(idx, idx, sizeof(TBIndirectEntry));
+        tcg_gen_ext_i32_ptr(slot, idx);
+        tcg_gen_add_ptr(slot, slot, jc);
+        tcg_gen_addi_ptr(slot, slot, offsetof(CPUJumpCache, ind));
+    } else {
+        unsigned idx = translator_ind_index(db, false);
+
+        tcg_gen_addi_ptr(slot, jc, offsetof(CPUJumpCache, ind[idx]));
+    }
+
+    miss = gen_new_label();
+    k = tcg_temp_new_i64();
+    tcg_gen_ld_i64(k, slot, offsetof(TBIndirectEntry, key));
+    tcg_gen_brcond_i64(TCG_COND_NE, k, key, miss);
+    host = tcg_temp_new_ptr();
+    tcg_gen_ld_ptr(host, slot, offsetof(TBIndirectEntry, site));
+    tcg_gen_brcondi_ptr(TCG_COND_NE, host, (intptr_t)db->tb, miss);
+    gen = tcg_temp_new_i32();
+    cur = tcg_temp_new_i32();
+    tcg_gen_ld_i32(gen, slot, offsetof(TBIndirectEntry, gen));
+    tcg_gen_ld_i32(cur, jc, offsetof(CPUJumpCache, ind_gen));
+    tcg_gen_brcond_i32(TCG_COND_NE, gen, cur, miss);
+    tcg_gen_ld_ptr(host, slot, offsetof(TBIndirectEntry, host));
+    tcg_gen_goto_ptr(host);
+
+    gen_set_label(miss);
+    gen_helper_lookup_tb_ptr_cached(host, tcg_env, slot, key,
+                                    tcg_constant_ptr(db->tb));
+    tcg_gen_goto_ptr(host);
+}
+
 void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
                      vaddr pc, void *host_pc, const TranslatorOps *ops,
                      DisasContextBase *db)
 {
     uint32_t cflags = tb_cflags(tb);
     TCGOp *icount_start_insn;
+    TCGLabel *hot_label;
     bool plugin_enabled;
 
     /* Initialize DisasContext */
@@ -142,12 +341,19 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
     db->saved_can_do_io = -1;
     db->host_addr[0] = host_pc;
     db->host_addr[1] = NULL;
+    db->trace_len = 0;
+    db->trace_idx = 0;
+    tb_nb_exits = 0;
+    if (cflags & CF_TRACE) {
+        memcpy(db->trace, tb_trace, tb_trace_len * sizeof(vaddr));
+        db->trace_len = tb_trace_len;
+    }
 
     ops->init_disas_context(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
     /* Start translating.  */
-    icount_start_insn = gen_tb_start(db, cflags);
+    icount_start_insn = gen_tb_start(db, cflags, &hot_label);
     ops->tb_start(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
@@ -203,7 +409,7 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
 
     /* Emit code to exit the TB, as indicated by db->is_jmp.  */
     ops->tb_stop(db, cpu);
-    gen_tb_end(tb, cflags, icount_start_insn, db->num_insns);
+    gen_tb_end(tb, cflags, icount_start_insn, db->num_insns, hot_label);
 
     if (plugin_enabled) {
         plugin_gen_tb_end(cpu, db->num_insns);
@@ -249,6 +455,11 @@ static void *translator_access(CPUArchState *env, DisasContextBase *db,
         if (host == NULL) {
             tb_page_addr_t page0, old_page1, new_page1;
 
+            /* Only the vCPU thread may fill its TLB. */
+            if (translator_background) {
+                siglongjmp(tcg_ctx->jmp_trans, -4);
+            }
+
             new_page1 = get_page_addr_code_hostp(env, base, &db->host_addr[1]);
 
             /*
@@ -22,6 +22,8 @@
 #include "exec/cpu-common.h"
 #include "hw/core/cpu.h"
 #include "sysemu/cpus.h"
+#include "sysemu/tcg.h"
+#include "exec/tb-flush.h"
 #include "qemu/lockable.h"
 #include "trace/trace-root.h"
 
@@ -397,6 +399,11 @@ int cpu_breakpoint_insert(CPUState *cpu, vaddr pc, int flags,
         *breakpoint = bp;
     }
 
+    /* Cached indirect branch targets bypass check_for_breakpoints(). */
+    if (tcg_enabled()) {
+        tcg_flush_jmp_cache(cpu);
+    }
+
     trace_breakpoint_insert(cpu->cpu_index, pc, flags);
     return 0;
 }
@@ -425,6 +432,10 @@ void cpu_breakpoint_remove_by_ref(CPUState *cpu, CPUBreakpoint *bp)
 {
     QTAILQ_REMOVE(&cpu->breakpoints, bp, entry);
 
+    if (tcg_enabled()) {
+        tcg_flush_jmp_cache(cpu);
+    }
+
     trace_breakpoint_remove(cpu->cpu_index, bp->pc, bp->flags);
     g_free(bp);
 }
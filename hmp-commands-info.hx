@@ -283,6 +283,21 @@ SRST
     Show dynamic compiler opcode counters
 ERST
 
+#if defined(CONFIG_TCG)
+    {
+        .name       = "tb-profile",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show the most executed translation blocks",
+    },
+#endif
+
+SRST
+  ``info tb-profile``
+    Show the most executed translation blocks and how they were left,
+    when enabled with ``-accel tcg,tb-profile=on``.
+ERST
+
     {
         .name       = "sync-profile",
         .args_type  = "mean:-m,no_coalesce:-n,max:i?",
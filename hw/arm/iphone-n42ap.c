@@ -1,5 +1,5 @@
 /*
- * iPhone 5 (N42AP) emulation
+ * iPhone 5 / 5c (N41AP, N42AP, N48AP) emulation
  *
  * Copyright (C) 2024 Iscle <albertiscle9@gmail.com>
  *
@@ -18,8 +18,13 @@
 #include "hw/boards.h"
 #include "hw/loader.h"
 #include "hw/arm/boot.h"
+#include "hw/qdev-properties.h"
+#include "qapi/qmp/qlist.h"
 #include "qom/object.h"
 
+/* Smallest SDRAM size accepted for headless test runs */
+#define IPHONE_MIN_RAM_SIZE     (16 * MiB)
+
 struct IphoneMachineState {
     /*< private >*/
     MachineState parent_obj;
@@ -35,6 +40,10 @@ struct IphoneMachineClass {
     MachineClass parent_obj;
 
     /*< public >*/
+    uint32_t board_id;
+    const uint32_t *board_id_pins;
+    int num_board_id_pins;
+    ram_addr_t ram_size;
 };
 typedef struct IphoneMachineClass IphoneMachineClass;
 
@@ -55,7 +64,6 @@ static void setup_boot(MachineState *machine, size_t ram_size)
      * the normal Linux boot process
      */
     if (machine->firmware) {
-        printf("Loading firmware... File: %s\n", machine->firmware);
         hwaddr firmware_addr = s->soc.memmap[S5L8950X_DEV_VROM];
         /* load the firmware image */
         r = load_image_targphys(machine->firmware, firmware_addr, 0x00010000);
@@ -67,7 +75,7 @@ static void setup_boot(MachineState *machine, size_t ram_size)
         s->binfo.entry = firmware_addr;
         s->binfo.firmware_loaded = true;
     } else {
-        printf("Firmware is required!\n");
+        error_report("Firmware is required");
         exit(1);
     }
 
@@ -76,45 +84,115 @@ static void setup_boot(MachineState *machine, size_t ram_size)
 
 static void iphone_machine_init(MachineState *machine)
 {
-//    IphoneMachineClass *mc = IPHONE_MACHINE_GET_CLASS(machine);
+    IphoneMachineClass *imc = IPHONE_MACHINE_GET_CLASS(machine);
     IphoneMachineState *s = IPHONE_MACHINE(machine);
+    DeviceState *gpio;
+    QList *board_id_pins;
 
-    if (machine->ram_size != 1 * GiB) {
-        char *size_str = size_to_str(1 * GiB);
-        error_report("Invalid RAM size, should be %s", size_str);
-        g_free(size_str);
+    /*
+     * The SDRAM window is sized for the production part, but smaller
+     * sizes are accepted so that headless test instances can be packed
+     * more densely.
+     */
+    if (machine->ram_size > imc->ram_size ||
+        machine->ram_size < IPHONE_MIN_RAM_SIZE ||
+        !QEMU_IS_ALIGNED(machine->ram_size, MiB)) {
+        char *min_str = size_to_str(IPHONE_MIN_RAM_SIZE);
+        char *max_str = size_to_str(imc->ram_size);
+        error_report("Invalid RAM size, should be a multiple of 1 MiB "
+                     "between %s and %s", min_str, max_str);
+        g_free(min_str);
+        g_free(max_str);
         exit(1);
     }
 
     /* SOC */
     object_initialize_child(OBJECT(machine), "soc", &s->soc, TYPE_S5L8950X);
+
+    /* Board ID straps */
+    gpio = DEVICE(&s->soc.gpio);
+    board_id_pins = qlist_new();
+    for (int i = 0; i < imc->num_board_id_pins; i++) {
+        qlist_append_int(board_id_pins, imc->board_id_pins[i]);
+    }
+    qdev_prop_set_array(gpio, "board-id-pins", board_id_pins);
+    qdev_prop_set_uint32(gpio, "board-id", imc->board_id);
+
+    /* Audio goes to the null sink unless an audiodev is given */
+    if (machine->audiodev) {
+        qdev_prop_set_string(DEVICE(&s->soc.audio), "audiodev", machine->audiodev);
+    }
+
     qdev_realize(DEVICE(&s->soc), NULL, &error_fatal);
 
     setup_boot(machine, machine->ram_size);
 }
 
+/* Board ID straps, LSB first */
+static const uint32_t iphone_board_id_pins[] = {
+    S5L8950X_GPIO(23, 0),
+    S5L8950X_GPIO(23, 1),
+    S5L8950X_GPIO(23, 2),
+    S5L8950X_GPIO(23, 3),
+};
+
 static void iphone_machine_class_common_init(MachineClass *mc)
 {
-    mc->desc = g_strdup("Apple iPhone 5 (N42AP)");
+    IphoneMachineClass *imc = IPHONE_MACHINE_CLASS(mc);
+
     mc->init = iphone_machine_init;
     mc->default_cpus = mc->min_cpus = mc->max_cpus = 2;
-    mc->default_ram_size = 1 * GiB;
     mc->default_ram_id = "ram";
+    machine_add_audiodev_property(mc);
+    imc->board_id_pins = iphone_board_id_pins;
+    imc->num_board_id_pins = ARRAY_SIZE(iphone_board_id_pins);
+    imc->ram_size = 1 * GiB;
+    mc->default_ram_size = imc->ram_size;
 };
 
+static void n41ap_machine_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+    IphoneMachineClass *imc = IPHONE_MACHINE_CLASS(oc);
+
+    iphone_machine_class_common_init(mc);
+    mc->desc = "Apple iPhone 5 GSM (N41AP)";
+    imc->board_id = 0x00;
+}
+
 static void n42ap_machine_class_init(ObjectClass *oc, void *data)
 {
     MachineClass *mc = MACHINE_CLASS(oc);
-//    IphoneMachineClass *imc = IPHONE_MACHINE_CLASS(oc);
+    IphoneMachineClass *imc = IPHONE_MACHINE_CLASS(oc);
 
     iphone_machine_class_common_init(mc);
+    mc->desc = "Apple iPhone 5 Global (N42AP)";
+    imc->board_id = 0x02;
+}
+
+static void n48ap_machine_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+    IphoneMachineClass *imc = IPHONE_MACHINE_CLASS(oc);
+
+    iphone_machine_class_common_init(mc);
+    mc->desc = "Apple iPhone 5c GSM (N48AP)";
+    imc->board_id = 0x0A;
 }
 
 static const TypeInfo iphone_machine_types[] = {
     {
+        .name           = MACHINE_TYPE_NAME("iphone-n41ap"),
+        .parent         = TYPE_IPHONE_MACHINE,
+        .class_init     = n41ap_machine_class_init,
+    }, {
         .name           = MACHINE_TYPE_NAME("iphone-n42ap"),
         .parent         = TYPE_IPHONE_MACHINE,
         .class_init     = n42ap_machine_class_init,
+    }, {
+        .name           = MACHINE_TYPE_NAME("iphone-n48ap"),
+        .parent         = TYPE_IPHONE_MACHINE,
+        .class_init     = n48ap_machine_class_init,
     }, {
         .name           = TYPE_IPHONE_MACHINE,
         .parent         = TYPE_MACHINE,
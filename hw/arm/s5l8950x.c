@@ -178,7 +178,7 @@ static void s5l8950x_init(Object *obj)
     s->memmap = s5l8950x_memmap;
 
     for (int i = 0; i < S5L8950X_NUM_CPUS; i++) {
-        object_initialize_child(obj, "cpu[*]", &s->cpu[i], ARM_CPU_TYPE_NAME("cortex-a15"));
+        object_initialize_child(obj, "cpu[*]", &s->cpu[i], ARM_CPU_TYPE_NAME("apple-swift"));
     }
 
     object_initialize_child(obj, "aic", &s->aic, TYPE_S5L8950X_AIC);
@@ -188,6 +188,7 @@ static void s5l8950x_init(Object *obj)
     object_initialize_child(obj, "gpio", &s->gpio, TYPE_S5L8950X_GPIO);
     object_initialize_child(obj, "pmgr", &s->pmgr, TYPE_S5L8950X_PMGR);
     object_initialize_child(obj, "chipid", &s->chipid, TYPE_S5L8950X_CHIPID);
+    object_initialize_child(obj, "audio", &s->audio, TYPE_S5L8950X_AUDIO);
 }
 
 static void s5l8950x_realize(DeviceState *dev, Error **errp)
@@ -204,9 +205,8 @@ static void s5l8950x_realize(DeviceState *dev, Error **errp)
          */
         qdev_prop_set_bit(DEVICE(&s->cpu[i]), "start-powered-off", i > 0);
 
-        /* All exception levels required */
+        /* Swift has the Security Extensions but no Virtualization Extensions */
         qdev_prop_set_bit(DEVICE(&s->cpu[i]), "has_el3", true);
-        qdev_prop_set_bit(DEVICE(&s->cpu[i]), "has_el2", true);
 
         /* Mark realized */
         qdev_realize(DEVICE(&s->cpu[i]), NULL, &error_fatal);
@@ -245,6 +245,12 @@ static void s5l8950x_realize(DeviceState *dev, Error **errp)
     sysbus_realize(SYS_BUS_DEVICE(&s->chipid), &error_fatal);
     sysbus_mmio_map(SYS_BUS_DEVICE(&s->chipid), 0, s->memmap[S5L8950X_DEV_CHIPID]);
 
+    /* Audio */
+    object_property_set_link(OBJECT(&s->audio), "dma-mr",
+                             OBJECT(get_system_memory()), &error_fatal);
+    sysbus_realize(SYS_BUS_DEVICE(&s->audio), &error_fatal);
+    sysbus_mmio_map(SYS_BUS_DEVICE(&s->audio), 0, s->memmap[S5L8950X_DEV_AUDIO]);
+
     /* Unimplemented devices */
     for (i = 0; i < ARRAY_SIZE(unimplemented); i++) {
         create_unimplemented_device(unimplemented[i].device_name, unimplemented[i].base, unimplemented[i].size);
@@ -0,0 +1,387 @@
+/*
+ * Apple A6 (S5L8950X) audio (I2S) emulation
+ *
+ * Only the playback path is modelled: the guest points the TX DMA at a
+ * buffer of 16-bit stereo samples in memory and the block raises DONE
+ * once it has been consumed.
+ *
+ * Without an audiodev (or with null-sink=on) the block acts as a null
+ * sink: buffers complete on a QEMU_CLOCK_VIRTUAL schedule derived from
+ * the programmed sample rate and sample data is never read, so headless
+ * instances don't pay for audio while drivers still see progress.
+ *
+ * Copyright (C) 2024 Iscle <albertiscle9@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qapi/error.h"
+#include "hw/audio/s5l8950x-audio.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "migration/vmstate.h"
+#include "sysemu/runstate.h"
+#include "trace.h"
+
+#define rI2S_CTRL               (0x00)
+#define I2S_CTRL_ENABLE         (1 << 0)
+#define I2S_CTRL_TX_ENABLE      (1 << 1)
+#define rI2S_RATE               (0x04)
+#define rI2S_INT_EN             (0x0C)
+#define I2S_INT_DMA_DONE        (1 << 0)
+#define rI2S_DMA_ADDR           (0x10)
+#define rI2S_DMA_LEN            (0x14)
+#define rI2S_DMA_CTRL           (0x18)
+#define I2S_DMA_CTRL_START      (1 << 0)
+#define I2S_DMA_CTRL_STOP       (1 << 1)
+#define rI2S_DMA_STATUS         (0x1C)
+#define I2S_DMA_STATUS_BUSY     (1 << 0)
+#define I2S_DMA_STATUS_DONE     (1 << 1)
+#define rI2S_DMA_POS            (0x20)
+
+#define I2S_RATE_RESET          (44100)
+
+// S16LE, 2 channels
+#define I2S_FRAME_BYTES         (4)
+
+static void s5l8950x_audio_update_irq(S5L8950XAudioState *s)
+{
+    bool level = (s->dma_status & I2S_DMA_STATUS_DONE) &&
+                 (s->int_en & I2S_INT_DMA_DONE);
+
+    qemu_set_irq(s->irq, level);
+}
+
+static void s5l8950x_audio_dma_done(S5L8950XAudioState *s)
+{
+    trace_s5l8950x_audio_dma_done(s->dma_addr, s->dma_len);
+
+    s->dma_pos = s->dma_len;
+    s->dma_status &= ~I2S_DMA_STATUS_BUSY;
+    s->dma_status |= I2S_DMA_STATUS_DONE;
+    timer_del(s->timer);
+    if (s->voice) {
+        AUD_set_active_out(s->voice, 0);
+    }
+    s5l8950x_audio_update_irq(s);
+}
+
+static void s5l8950x_audio_dma_stop(S5L8950XAudioState *s)
+{
+    s->dma_status &= ~I2S_DMA_STATUS_BUSY;
+    timer_del(s->timer);
+    if (s->voice) {
+        AUD_set_active_out(s->voice, 0);
+    }
+}
+
+static void s5l8950x_audio_timer(void *opaque)
+{
+    S5L8950XAudioState *s = opaque;
+
+    s5l8950x_audio_dma_done(s);
+}
+
+static void s5l8950x_audio_callback(void *opaque, int free)
+{
+    S5L8950XAudioState *s = opaque;
+
+    if (!(s->dma_status & I2S_DMA_STATUS_BUSY)) {
+        return;
+    }
+
+    while (free > 0 && s->dma_pos < s->dma_len) {
+        size_t n = MIN(MIN((uint32_t)free, s->dma_len - s->dma_pos),
+                       sizeof(s->buf));
+        size_t written;
+
+        address_space_read(&s->dma_as, s->dma_addr + s->dma_pos,
+                           MEMTXATTRS_UNSPECIFIED, s->buf, n);
+        written = AUD_write(s->voice, s->buf, n);
+        s->dma_pos += written;
+        free -= written;
+        if (written < n) {
+            break;
+        }
+    }
+
+    if (s->dma_pos >= s->dma_len) {
+        s5l8950x_audio_dma_done(s);
+    }
+}
+
+static void s5l8950x_audio_open_voice(S5L8950XAudioState *s)
+{
+    struct audsettings as = { s->rate, 2, AUDIO_FORMAT_S16, 0 };
+
+    if (s->voice && s->voice_rate == s->rate) {
+        return;
+    }
+
+    s->voice = AUD_open_out(&s->card, s->voice, TYPE_S5L8950X_AUDIO, s,
+                            s5l8950x_audio_callback, &as);
+    s->voice_rate = s->rate;
+}
+
+static void s5l8950x_audio_dma_start(S5L8950XAudioState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    if (!(s->ctrl & I2S_CTRL_ENABLE) || !(s->ctrl & I2S_CTRL_TX_ENABLE)) {
+        qemu_log_mask(LOG_GUEST_ERROR, "s5l8950x_audio: DMA started with TX disabled\n");
+        return;
+    }
+    if (!s->rate) {
+        qemu_log_mask(LOG_GUEST_ERROR, "s5l8950x_audio: DMA started with a zero sample rate\n");
+        return;
+    }
+
+    trace_s5l8950x_audio_dma_start(s->dma_addr, s->dma_len, s->rate, s->null_sink);
+
+    s->dma_pos = 0;
+    s->dma_start_ns = now;
+    s->dma_status |= I2S_DMA_STATUS_BUSY;
+
+    if (s->dma_len < I2S_FRAME_BYTES) {
+        s5l8950x_audio_dma_done(s);
+        return;
+    }
+
+    if (s->null_sink) {
+        timer_mod(s->timer, now + muldiv64(s->dma_len / I2S_FRAME_BYTES,
+                                           NANOSECONDS_PER_SECOND, s->rate));
+    } else {
+        s5l8950x_audio_open_voice(s);
+        AUD_set_active_out(s->voice, 1);
+    }
+}
+
+static uint32_t s5l8950x_audio_dma_pos(S5L8950XAudioState *s)
+{
+    int64_t elapsed;
+    uint64_t frames;
+
+    if (!s->null_sink || !(s->dma_status & I2S_DMA_STATUS_BUSY)) {
+        return s->dma_pos;
+    }
+
+    // Nothing is transferred by the null sink, derive the position from the elapsed time
+    elapsed = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->dma_start_ns;
+    frames = muldiv64(MAX(elapsed, 0), s->rate, NANOSECONDS_PER_SECOND);
+
+    return MIN(frames * I2S_FRAME_BYTES, s->dma_len);
+}
+
+static uint64_t s5l8950x_audio_read(void *opaque, hwaddr offset,
+                                      unsigned size)
+{
+    S5L8950XAudioState *s = (S5L8950XAudioState *)opaque;
+    uint32_t res = 0;
+
+    switch (offset) {
+    case rI2S_CTRL:
+        res = s->ctrl;
+        break;
+    case rI2S_RATE:
+        res = s->rate;
+        break;
+    case rI2S_INT_EN:
+        res = s->int_en;
+        break;
+    case rI2S_DMA_ADDR:
+        res = s->dma_addr;
+        break;
+    case rI2S_DMA_LEN:
+        res = s->dma_len;
+        break;
+    case rI2S_DMA_CTRL:
+        res = 0;
+        break;
+    case rI2S_DMA_STATUS:
+        res = s->dma_status;
+        break;
+    case rI2S_DMA_POS:
+        res = s5l8950x_audio_dma_pos(s);
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "s5l8950x_audio_read: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
+        res = 0;
+        break;
+    }
+
+    trace_s5l8950x_audio_read(offset, res, size);
+
+    return res;
+}
+
+static void s5l8950x_audio_write(void *opaque, hwaddr offset,
+                                   uint64_t value, unsigned size)
+{
+    S5L8950XAudioState *s = (S5L8950XAudioState *)opaque;
+
+    trace_s5l8950x_audio_write(offset, value, size);
+
+    switch (offset) {
+    case rI2S_CTRL:
+        s->ctrl = value;
+        if (!(s->ctrl & I2S_CTRL_ENABLE) || !(s->ctrl & I2S_CTRL_TX_ENABLE)) {
+            s5l8950x_audio_dma_stop(s);
+        }
+        break;
+    case rI2S_RATE:
+        s->rate = value;
+        break;
+    case rI2S_INT_EN:
+        s->int_en = value;
+        s5l8950x_audio_update_irq(s);
+        break;
+    case rI2S_DMA_ADDR:
+        s->dma_addr = value;
+        break;
+    case rI2S_DMA_LEN:
+        s->dma_len = value;
+        break;
+    case rI2S_DMA_CTRL:
+        if (value & I2S_DMA_CTRL_STOP) {
+            s5l8950x_audio_dma_stop(s);
+        } else if (value & I2S_DMA_CTRL_START) {
+            s5l8950x_audio_dma_start(s);
+        }
+        break;
+    case rI2S_DMA_STATUS:
+        // Write 1 to clear
+        s->dma_status &= ~(value & I2S_DMA_STATUS_DONE);
+        s5l8950x_audio_update_irq(s);
+        break;
+    default:
+        qemu_log_mask(LOG_UNIMP, "s5l8950x_audio_write: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
+        break;
+    }
+}
+
+static const MemoryRegionOps s5l8950x_audio_ops = {
+    .read = s5l8950x_audio_read,
+    .write = s5l8950x_audio_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+//    .impl.min_access_size = 4,
+//    .impl.max_access_size = 4,
+};
+
+static int s5l8950x_audio_post_load(void *opaque, int version_id)
+{
+    S5L8950XAudioState *s = opaque;
+
+    if (!s->null_sink && (s->dma_status & I2S_DMA_STATUS_BUSY)) {
+        s5l8950x_audio_open_voice(s);
+        AUD_set_active_out(s->voice, 1);
+    }
+
+    return 0;
+}
+
+static const VMStateDescription vmstate_s5l8950x_audio = {
+    .name = TYPE_S5L8950X_AUDIO,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = s5l8950x_audio_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(ctrl, S5L8950XAudioState),
+        VMSTATE_UINT32(rate, S5L8950XAudioState),
+        VMSTATE_UINT32(int_en, S5L8950XAudioState),
+        VMSTATE_UINT32(dma_addr, S5L8950XAudioState),
+        VMSTATE_UINT32(dma_len, S5L8950XAudioState),
+        VMSTATE_UINT32(dma_status, S5L8950XAudioState),
+        VMSTATE_UINT32(dma_pos, S5L8950XAudioState),
+        VMSTATE_INT64(dma_start_ns, S5L8950XAudioState),
+        VMSTATE_TIMER_PTR(timer, S5L8950XAudioState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void s5l8950x_audio_init(Object *obj)
+{
+    S5L8950XAudioState *s = S5L8950X_AUDIO(obj);
+
+    memory_region_init_io(&s->iomem, obj, &s5l8950x_audio_ops, s, TYPE_S5L8950X_AUDIO, 0x100000);
+    sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->iomem);
+    sysbus_init_irq(SYS_BUS_DEVICE(s), &s->irq);
+}
+
+static void s5l8950x_audio_realize(DeviceState *dev, Error **errp)
+{
+    S5L8950XAudioState *s = S5L8950X_AUDIO(dev);
+
+    if (!s->dma_mr) {
+        error_setg(errp, TYPE_S5L8950X_AUDIO " 'dma-mr' link not set");
+        return;
+    }
+    address_space_init(&s->dma_as, s->dma_mr, TYPE_S5L8950X_AUDIO "-dma");
+
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, s5l8950x_audio_timer, s);
+
+    // No backend configured: complete buffers without producing any output
+    if (!s->card.state) {
+        s->null_sink = true;
+    }
+    if (!s->null_sink && !AUD_register_card(TYPE_S5L8950X_AUDIO, &s->card, errp)) {
+        return;
+    }
+}
+
+static void s5l8950x_audio_reset(DeviceState *dev)
+{
+    S5L8950XAudioState *s = S5L8950X_AUDIO(dev);
+
+    trace_s5l8950x_audio_reset();
+
+    s5l8950x_audio_dma_stop(s);
+
+    s->ctrl = 0;
+    s->rate = I2S_RATE_RESET;
+    s->int_en = 0;
+    s->dma_addr = 0;
+    s->dma_len = 0;
+    s->dma_status = 0;
+    s->dma_pos = 0;
+    s->dma_start_ns = 0;
+
+    s5l8950x_audio_update_irq(s);
+}
+
+static Property s5l8950x_audio_properties[] = {
+    DEFINE_AUDIO_PROPERTIES(S5L8950XAudioState, card),
+    DEFINE_PROP_LINK("dma-mr", S5L8950XAudioState, dma_mr, TYPE_MEMORY_REGION,
+                     MemoryRegion *),
+    DEFINE_PROP_BOOL("null-sink", S5L8950XAudioState, null_sink, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void s5l8950x_audio_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->realize = s5l8950x_audio_realize;
+    dc->reset = s5l8950x_audio_reset;
+    dc->vmsd = &vmstate_s5l8950x_audio;
+    device_class_set_props(dc, s5l8950x_audio_properties);
+    set_bit(DEVICE_CATEGORY_SOUND, dc->categories);
+}
+
+static const TypeInfo s5l8950x_audio_info = {
+    .name          = TYPE_S5L8950X_AUDIO,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(S5L8950XAudioState),
+    .class_init    = s5l8950x_audio_class_init,
+    .instance_init = s5l8950x_audio_init,
+};
+
+static void s5l8950x_audio_register_types(void)
+{
+    type_register_static(&s5l8950x_audio_info);
+}
+
+type_init(s5l8950x_audio_register_types)
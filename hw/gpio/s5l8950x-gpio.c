@@ -10,55 +10,70 @@
 #include "qemu/osdep.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "qapi/error.h"
 #include "hw/gpio/s5l8950x-gpio.h"
+#include "hw/qdev-properties.h"
 #include "migration/vmstate.h"
 #include "sysemu/runstate.h"
+#include "trace.h"
 
 // S5L8950X has Apple GPIO_VERSION 2
 
-// gpion = pad * GPIOPADPINS + pin
-
-#define GPIOPADPINS     (8)
-
 #define rGPIOCFG(_n)    (0x000 + (_n) * 4)
 #define rGPIOINT(_n)    (0x800 + (_n) * 4)
 
-#define GPIO(pad, pin)  ((pad) * GPIOPADPINS + (pin))
+#define GPIO(pad, pin)  S5L8950X_GPIO(pad, pin)
 
 static uint64_t s5l8950x_gpio_read(void *opaque, hwaddr offset,
                                       unsigned size)
 {
-//    S5L8950XGpioState *s = (S5L8950XGpioState *)opaque;
+    S5L8950XGpioState *s = (S5L8950XGpioState *)opaque;
     uint32_t res = 0;
 
     switch (offset) {
+    case rGPIOCFG(0) ... rGPIOCFG(S5L8950X_GPIO_NUM_PINS - 1):
+        res = s->cfg[(offset - rGPIOCFG(0)) / 4];
+        switch (offset) {
         case rGPIOCFG(GPIO(0, 0)):
-            printf("s5l8950x_gpio_read: rGPIOCFG(GPIO_REQUEST_DFU2)\n");
-            res = 0x00000001; // Return 1, button pull up
+            trace_s5l8950x_gpio_strap("GPIO_REQUEST_DFU2", res);
             break;
         case rGPIOCFG(GPIO(0, 1)):
-            printf("s5l8950x_gpio_read: rGPIOCFG(GPIO_REQUEST_DFU1)\n");
-            res = 0x00000001; // Return 1, button pull up
+            trace_s5l8950x_gpio_strap("GPIO_REQUEST_DFU1", res);
             break;
         case rGPIOCFG(GPIO(25, 6)):
-            printf("s5l8950x_gpio_read: rGPIOCFG(GPIO_FORCE_DFU)\n");
-            res = 0x00000000; // Return 0
+            trace_s5l8950x_gpio_strap("GPIO_FORCE_DFU", res);
             break;
+        }
+        break;
+    case rGPIOINT(0) ... rGPIOINT(S5L8950X_GPIO_NUM_INT - 1):
+        res = s->int_status[(offset - rGPIOINT(0)) / 4];
+        break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_gpio_read: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
         res = 0;
         break;
     }
 
+    trace_s5l8950x_gpio_read(offset, res, size);
+
     return res;
 }
 
 static void s5l8950x_gpio_write(void *opaque, hwaddr offset,
                                    uint64_t value, unsigned size)
 {
-//    S5L8950XGpioState *s = (S5L8950XGpioState *)opaque;
+    S5L8950XGpioState *s = (S5L8950XGpioState *)opaque;
+
+    trace_s5l8950x_gpio_write(offset, value, size);
 
     switch (offset) {
+    case rGPIOCFG(0) ... rGPIOCFG(S5L8950X_GPIO_NUM_PINS - 1):
+        s->cfg[(offset - rGPIOCFG(0)) / 4] = value;
+        break;
+    case rGPIOINT(0) ... rGPIOINT(S5L8950X_GPIO_NUM_INT - 1):
+        // Write 1 to clear
+        s->int_status[(offset - rGPIOINT(0)) / 4] &= ~value;
+        break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_gpio_write: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
         break;
@@ -73,46 +88,80 @@ static const MemoryRegionOps s5l8950x_gpio_ops = {
 //    .impl.max_access_size = 4,
 };
 
-//static const VMStateDescription vmstate_s5l8950x_gpio = {
-//    .name = TYPE_S5L8950X_GPIO,
-//    .version_id = 1,
-//    .minimum_version_id = 1,
-//    .fields = (VMStateField[]) {
-//        VMSTATE_UINT32(rstc, S5L8950XGpioState),
-//        VMSTATE_UINT32(rsts, S5L8950XGpioState),
-//        VMSTATE_UINT32(wdog, S5L8950XGpioState),
-//        VMSTATE_END_OF_LIST()
-//    }
-//};
+static const VMStateDescription vmstate_s5l8950x_gpio = {
+    .name = TYPE_S5L8950X_GPIO,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(cfg, S5L8950XGpioState, S5L8950X_GPIO_NUM_PINS),
+        VMSTATE_UINT32_ARRAY(int_status, S5L8950XGpioState,
+                             S5L8950X_GPIO_NUM_INT),
+        VMSTATE_END_OF_LIST()
+    }
+};
 
 static void s5l8950x_gpio_init(Object *obj)
 {
     S5L8950XGpioState *s = S5L8950X_GPIO(obj);
 
-    printf("s5l8950x_gpio_init\n");
     memory_region_init_io(&s->iomem, obj, &s5l8950x_gpio_ops, s, TYPE_S5L8950X_GPIO, 0x100000);
     sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->iomem);
 }
 
 static void s5l8950x_gpio_reset(DeviceState *dev)
 {
-//    S5L8950XGpioState *s = S5L8950X_GPIO(dev);
+    S5L8950XGpioState *s = S5L8950X_GPIO(dev);
 
-    printf("s5l8950x_gpio_reset\n");
+    trace_s5l8950x_gpio_reset();
 
-//    s->rstc = 0x00000102;
-//    s->rsts = 0x00001000;
-//    s->wdog = 0x00000000;
+    memset(s->cfg, 0, sizeof(s->cfg));
+    memset(s->int_status, 0, sizeof(s->int_status));
+
+    s->cfg[GPIO(0, 0)] = 0x00000001; // GPIO_REQUEST_DFU2, button pull up
+    s->cfg[GPIO(0, 1)] = 0x00000001; // GPIO_REQUEST_DFU1, button pull up
+    s->cfg[GPIO(25, 6)] = 0x00000000; // GPIO_FORCE_DFU
+
+    // Board ID straps, LSB first
+    for (uint32_t i = 0; i < s->num_board_id_pins; i++) {
+        s->cfg[s->board_id_pins[i]] = (s->board_id >> i) & 1;
+    }
 }
 
+static void s5l8950x_gpio_realize(DeviceState *dev, Error **errp)
+{
+    S5L8950XGpioState *s = S5L8950X_GPIO(dev);
+
+    for (uint32_t i = 0; i < s->num_board_id_pins; i++) {
+        if (s->board_id_pins[i] >= S5L8950X_GPIO_NUM_PINS) {
+            error_setg(errp, "board-id-pins[%u]: invalid GPIO %u",
+                       i, s->board_id_pins[i]);
+            return;
+        }
+    }
+}
+
+static void s5l8950x_gpio_finalize(Object *obj)
+{
+    S5L8950XGpioState *s = S5L8950X_GPIO(obj);
+
+    g_free(s->board_id_pins);
+}
+
+static Property s5l8950x_gpio_properties[] = {
+    DEFINE_PROP_UINT32("board-id", S5L8950XGpioState, board_id, 0),
+    DEFINE_PROP_ARRAY("board-id-pins", S5L8950XGpioState, num_board_id_pins,
+                      board_id_pins, qdev_prop_uint32, uint32_t),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void s5l8950x_gpio_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
-    printf("s5l8950x_gpio_class_init\n");
-
+    dc->realize = s5l8950x_gpio_realize;
     dc->reset = s5l8950x_gpio_reset;
-//    dc->vmsd = &vmstate_s5l8950x_gpio;
+    dc->vmsd = &vmstate_s5l8950x_gpio;
+    device_class_set_props(dc, s5l8950x_gpio_properties);
 }
 
 static const TypeInfo s5l8950x_gpio_info = {
@@ -121,6 +170,7 @@ static const TypeInfo s5l8950x_gpio_info = {
     .instance_size = sizeof(S5L8950XGpioState),
     .class_init    = s5l8950x_gpio_class_init,
     .instance_init = s5l8950x_gpio_init,
+    .instance_finalize = s5l8950x_gpio_finalize,
 };
 
 static void s5l8950x_gpio_register_types(void)
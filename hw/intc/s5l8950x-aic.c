@@ -13,11 +13,25 @@
 #include "hw/intc/s5l8950x-aic.h"
 #include "migration/vmstate.h"
 #include "sysemu/runstate.h"
+#include "trace.h"
 #include "qemu/timer.h"
 
 // AIC_VERSION 1 for A6 (S5L8950X)
-#define rAIC_TIME_LO    (0x0020)
-#define rAIC_TIME_HI    (0x0028)
+#define rAIC_GLB_CFG            (0x0010)
+#define rAIC_TIME_LO            (0x0020)
+#define rAIC_TIME_HI            (0x0028)
+#define rAIC_IPI_SET            (0x2008)
+#define rAIC_IPI_CLR            (0x200C)
+#define rAIC_IPI_MASK_SET       (0x2024)
+#define rAIC_IPI_MASK_CLR       (0x2028)
+#define rAIC_EIR_DEST(_n)       (0x3000 + (_n) * 4)
+#define rAIC_EIR_SW_SET(_n)     (0x4000 + (_n) * 4)
+#define rAIC_EIR_SW_CLR(_n)     (0x4080 + (_n) * 4)
+#define rAIC_EIR_MASK_SET(_n)   (0x4100 + (_n) * 4)
+#define rAIC_EIR_MASK_CLR(_n)   (0x4180 + (_n) * 4)
+#define rAIC_EIR_INT_RO(_n)     (0x4200 + (_n) * 4)
+
+#define AIC_EIR_MASK_RESET      (0xFFFFFFFF)
 
 static uint64_t get_current_time(void)
 {
@@ -31,13 +45,32 @@ static uint64_t s5l8950x_aic_read(void *opaque, hwaddr offset,
     uint32_t res = 0;
 
     switch (offset) {
+    case rAIC_GLB_CFG:
+        res = s->glb_cfg;
+        break;
     case rAIC_TIME_LO:
-        uint32_t time_lo = get_current_time() & 0xFFFFFFFF;
-        res = time_lo;
+        res = get_current_time() & 0xFFFFFFFF;
         break;
     case rAIC_TIME_HI:
-        uint32_t time_hi = (get_current_time() >> 32) & 0xFFFFFFFF;
-        res = time_hi;
+        res = (get_current_time() >> 32) & 0xFFFFFFFF;
+        break;
+    case rAIC_IPI_SET:
+        res = s->ipi_pending;
+        break;
+    case rAIC_IPI_MASK_SET:
+        res = s->ipi_mask;
+        break;
+    case rAIC_EIR_DEST(0) ... rAIC_EIR_DEST(S5L8950X_AIC_NUM_IRQS - 1):
+        res = s->eir_dest[(offset - rAIC_EIR_DEST(0)) / 4];
+        break;
+    case rAIC_EIR_SW_SET(0) ... rAIC_EIR_SW_SET(S5L8950X_AIC_NUM_EIR - 1):
+        res = s->eir_sw_pending[(offset - rAIC_EIR_SW_SET(0)) / 4];
+        break;
+    case rAIC_EIR_MASK_SET(0) ... rAIC_EIR_MASK_SET(S5L8950X_AIC_NUM_EIR - 1):
+        res = s->eir_mask[(offset - rAIC_EIR_MASK_SET(0)) / 4];
+        break;
+    case rAIC_EIR_INT_RO(0) ... rAIC_EIR_INT_RO(S5L8950X_AIC_NUM_EIR - 1):
+        res = s->eir_sw_pending[(offset - rAIC_EIR_INT_RO(0)) / 4];
         break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_aic_read: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
@@ -45,15 +78,49 @@ static uint64_t s5l8950x_aic_read(void *opaque, hwaddr offset,
         break;
     }
 
+    trace_s5l8950x_aic_read(offset, res, size);
+
     return res;
 }
 
 static void s5l8950x_aic_write(void *opaque, hwaddr offset,
                                    uint64_t value, unsigned size)
 {
-//    S5L8950XAicState *s = (S5L8950XAicState *)opaque;
+    S5L8950XAicState *s = (S5L8950XAicState *)opaque;
+
+    trace_s5l8950x_aic_write(offset, value, size);
 
     switch (offset) {
+    case rAIC_GLB_CFG:
+        s->glb_cfg = value;
+        break;
+    case rAIC_IPI_SET:
+        s->ipi_pending |= value;
+        break;
+    case rAIC_IPI_CLR:
+        s->ipi_pending &= ~value;
+        break;
+    case rAIC_IPI_MASK_SET:
+        s->ipi_mask |= value;
+        break;
+    case rAIC_IPI_MASK_CLR:
+        s->ipi_mask &= ~value;
+        break;
+    case rAIC_EIR_DEST(0) ... rAIC_EIR_DEST(S5L8950X_AIC_NUM_IRQS - 1):
+        s->eir_dest[(offset - rAIC_EIR_DEST(0)) / 4] = value;
+        break;
+    case rAIC_EIR_SW_SET(0) ... rAIC_EIR_SW_SET(S5L8950X_AIC_NUM_EIR - 1):
+        s->eir_sw_pending[(offset - rAIC_EIR_SW_SET(0)) / 4] |= value;
+        break;
+    case rAIC_EIR_SW_CLR(0) ... rAIC_EIR_SW_CLR(S5L8950X_AIC_NUM_EIR - 1):
+        s->eir_sw_pending[(offset - rAIC_EIR_SW_CLR(0)) / 4] &= ~value;
+        break;
+    case rAIC_EIR_MASK_SET(0) ... rAIC_EIR_MASK_SET(S5L8950X_AIC_NUM_EIR - 1):
+        s->eir_mask[(offset - rAIC_EIR_MASK_SET(0)) / 4] |= value;
+        break;
+    case rAIC_EIR_MASK_CLR(0) ... rAIC_EIR_MASK_CLR(S5L8950X_AIC_NUM_EIR - 1):
+        s->eir_mask[(offset - rAIC_EIR_MASK_CLR(0)) / 4] &= ~value;
+        break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_aic_write: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
         break;
@@ -68,46 +135,54 @@ static const MemoryRegionOps s5l8950x_aic_ops = {
 //    .impl.max_access_size = 4,
 };
 
-//static const VMStateDescription vmstate_s5l8950x_aic = {
-//    .name = TYPE_S5L8950X_AIC,
-//    .version_id = 1,
-//    .minimum_version_id = 1,
-//    .fields = (VMStateField[]) {
-//        VMSTATE_UINT32(rstc, S5L8950XAicState),
-//        VMSTATE_UINT32(rsts, S5L8950XAicState),
-//        VMSTATE_UINT32(wdog, S5L8950XAicState),
-//        VMSTATE_END_OF_LIST()
-//    }
-//};
+static const VMStateDescription vmstate_s5l8950x_aic = {
+    .name = TYPE_S5L8950X_AIC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(glb_cfg, S5L8950XAicState),
+        VMSTATE_UINT32(ipi_pending, S5L8950XAicState),
+        VMSTATE_UINT32(ipi_mask, S5L8950XAicState),
+        VMSTATE_UINT32_ARRAY(eir_dest, S5L8950XAicState,
+                             S5L8950X_AIC_NUM_IRQS),
+        VMSTATE_UINT32_ARRAY(eir_sw_pending, S5L8950XAicState,
+                             S5L8950X_AIC_NUM_EIR),
+        VMSTATE_UINT32_ARRAY(eir_mask, S5L8950XAicState,
+                             S5L8950X_AIC_NUM_EIR),
+        VMSTATE_END_OF_LIST()
+    }
+};
 
 static void s5l8950x_aic_init(Object *obj)
 {
     S5L8950XAicState *s = S5L8950X_AIC(obj);
 
-    printf("s5l8950x_aic_init\n");
     memory_region_init_io(&s->iomem, obj, &s5l8950x_aic_ops, s, TYPE_S5L8950X_AIC, 0x100000);
     sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->iomem);
 }
 
 static void s5l8950x_aic_reset(DeviceState *dev)
 {
-//    S5L8950XAicState *s = S5L8950X_AIC(dev);
+    S5L8950XAicState *s = S5L8950X_AIC(dev);
 
-    printf("s5l8950x_aic_reset\n");
+    trace_s5l8950x_aic_reset();
 
-//    s->rstc = 0x00000102;
-//    s->rsts = 0x00001000;
-//    s->wdog = 0x00000000;
+    s->glb_cfg = 0;
+    s->ipi_pending = 0;
+    s->ipi_mask = 0;
+    memset(s->eir_dest, 0, sizeof(s->eir_dest));
+    memset(s->eir_sw_pending, 0, sizeof(s->eir_sw_pending));
+    for (int i = 0; i < S5L8950X_AIC_NUM_EIR; i++) {
+        s->eir_mask[i] = AIC_EIR_MASK_RESET;
+    }
 }
 
 static void s5l8950x_aic_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
-    printf("s5l8950x_aic_class_init\n");
-
     dc->reset = s5l8950x_aic_reset;
-//    dc->vmsd = &vmstate_s5l8950x_aic;
+    dc->vmsd = &vmstate_s5l8950x_aic;
 }
 
 static const TypeInfo s5l8950x_aic_info = {
@@ -13,6 +13,7 @@
 #include "hw/misc/s5l8950x-chipid.h"
 #include "migration/vmstate.h"
 #include "sysemu/runstate.h"
+#include "trace.h"
 
 #define	rCFG_FUSE0                                      (0x00)
 #define CFG_FUSE0_PRODUCTION_MODE                       (1 << 0)
@@ -41,13 +42,23 @@
 static uint64_t s5l8950x_chipid_read(void *opaque, hwaddr offset,
                                       unsigned size)
 {
-//    S5L8950XChipIdState *s = (S5L8950XChipIdState *)opaque;
+    S5L8950XChipIdState *s = (S5L8950XChipIdState *)opaque;
     uint32_t res = 0;
 
     switch (offset) {
     case rCFG_FUSE0:
-        printf("s5l8950x_chipid_read: rCFG_FUSE0\n");
-        res = 0x00000000;
+    case rCFG_FUSE1:
+    case rCFG_FUSE2:
+    case rCFG_FUSE3:
+    case rCFG_FUSE4:
+    case rCFG_FUSE5:
+        res = s->cfg_fuse[(offset - rCFG_FUSE0) / 4];
+        break;
+    case rECIDLO:
+        res = s->ecid & 0xFFFFFFFF;
+        break;
+    case rECIDHI:
+        res = (s->ecid >> 32) & 0xFFFFFFFF;
         break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_chipid_read: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
@@ -55,6 +66,8 @@ static uint64_t s5l8950x_chipid_read(void *opaque, hwaddr offset,
         break;
     }
 
+    trace_s5l8950x_chipid_read(offset, res, size);
+
     return res;
 }
 
@@ -63,6 +76,8 @@ static void s5l8950x_chipid_write(void *opaque, hwaddr offset,
 {
 //    S5L8950XChipIdState *s = (S5L8950XChipIdState *)opaque;
 
+    trace_s5l8950x_chipid_write(offset, value, size);
+
     switch (offset) {
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_chipid_write: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
@@ -78,46 +93,43 @@ static const MemoryRegionOps s5l8950x_chipid_ops = {
 //    .impl.max_access_size = 4,
 };
 
-//static const VMStateDescription vmstate_s5l8950x_chipid = {
-//    .name = TYPE_S5L8950X_CHIPID,
-//    .version_id = 1,
-//    .minimum_version_id = 1,
-//    .fields = (VMStateField[]) {
-//        VMSTATE_UINT32(rstc, S5L8950XChipIdState),
-//        VMSTATE_UINT32(rsts, S5L8950XChipIdState),
-//        VMSTATE_UINT32(wdog, S5L8950XChipIdState),
-//        VMSTATE_END_OF_LIST()
-//    }
-//};
+static const VMStateDescription vmstate_s5l8950x_chipid = {
+    .name = TYPE_S5L8950X_CHIPID,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(cfg_fuse, S5L8950XChipIdState,
+                             S5L8950X_CHIPID_NUM_CFG_FUSES),
+        VMSTATE_UINT64(ecid, S5L8950XChipIdState),
+        VMSTATE_END_OF_LIST()
+    }
+};
 
 static void s5l8950x_chipid_init(Object *obj)
 {
     S5L8950XChipIdState *s = S5L8950X_CHIPID(obj);
 
-    printf("s5l8950x_chipid_init\n");
     memory_region_init_io(&s->iomem, obj, &s5l8950x_chipid_ops, s, TYPE_S5L8950X_CHIPID, 0x100000);
     sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->iomem);
 }
 
 static void s5l8950x_chipid_reset(DeviceState *dev)
 {
-//    S5L8950XChipIdState *s = S5L8950X_CHIPID(dev);
+    S5L8950XChipIdState *s = S5L8950X_CHIPID(dev);
 
-    printf("s5l8950x_chipid_reset\n");
+    trace_s5l8950x_chipid_reset();
 
-//    s->rstc = 0x00000102;
-//    s->rsts = 0x00001000;
-//    s->wdog = 0x00000000;
+    // Development, insecure fused part
+    memset(s->cfg_fuse, 0, sizeof(s->cfg_fuse));
+    s->ecid = 0;
 }
 
 static void s5l8950x_chipid_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
-    printf("s5l8950x_chipid_class_init\n");
-
     dc->reset = s5l8950x_chipid_reset;
-//    dc->vmsd = &vmstate_s5l8950x_chipid;
+    dc->vmsd = &vmstate_s5l8950x_chipid;
 }
 
 static const TypeInfo s5l8950x_chipid_info = {
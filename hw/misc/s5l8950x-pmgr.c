@@ -13,6 +13,7 @@
 #include "hw/misc/s5l8950x-pmgr.h"
 #include "migration/vmstate.h"
 #include "sysemu/runstate.h"
+#include "trace.h"
 
 #define	rPMGR_PLL_CTL0(_n)  (0x0000 + ((_n) * 0x18))
 #define	PMGR_PLL_ENABLE     (1 << 31)
@@ -28,17 +29,26 @@
 #define PMGR_DOUBLER_DEBUG_ENABLED      (1 << 31)
 #define PMGR_DOUBLER_DEBUG_BYP_ENABLED  (1 << 30)
 
-#define	rPMGR_SCRATCH0  (0x6000)
+#define	rPMGR_SCRATCH(_n)   (0x6000 + ((_n) * 4))
 
 static uint64_t s5l8950x_pmgr_read(void *opaque, hwaddr offset,
                                       unsigned size)
 {
-//    S5L8950XPmgrState *s = (S5L8950XPmgrState *)opaque;
+    S5L8950XPmgrState *s = (S5L8950XPmgrState *)opaque;
     uint32_t res = 0;
 
     switch (offset) {
+    case rPMGR_PLL_CTL0(0):
+    case rPMGR_PLL_CTL0(1):
+    case rPMGR_PLL_CTL0(2):
+    case rPMGR_PLL_CTL0(3):
     case rPMGR_PLL_CTL0(4):
-        res = PMGR_PLL_REAL_LOCK;
+    case rPMGR_PLL_CTL0(5):
+    case rPMGR_PLL_CTL0(6):
+    case rPMGR_PLL_CTL0(7):
+    case rPMGR_PLL_CTL0(8):
+        // PLLs lock instantly
+        res = s->pll_ctl0[offset / rPMGR_PLL_CTL0(1)] | PMGR_PLL_REAL_LOCK;
         break;
     case rPMGR_PLL_DEBUG(2):
     case rPMGR_PLL_DEBUG(3):
@@ -52,9 +62,8 @@ static uint64_t s5l8950x_pmgr_read(void *opaque, hwaddr offset,
     case rPMGR_DOUBLER_DEBUG:
         res = PMGR_DOUBLER_DEBUG_BYP_ENABLED;
         break;
-    case rPMGR_SCRATCH0:
-        // boot_config_mask = 0xFF << 8
-        res = 4 << 8; // FMI0 2 CS (First NAND entry, might not be the one that the iPhone 5 uses)
+    case rPMGR_SCRATCH(0) ... rPMGR_SCRATCH(S5L8950X_PMGR_NUM_SCRATCH - 1):
+        res = s->scratch[(offset - rPMGR_SCRATCH(0)) / 4];
         break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_pmgr_read: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
@@ -62,15 +71,34 @@ static uint64_t s5l8950x_pmgr_read(void *opaque, hwaddr offset,
         break;
     }
 
+    trace_s5l8950x_pmgr_read(offset, res, size);
+
     return res;
 }
 
 static void s5l8950x_pmgr_write(void *opaque, hwaddr offset,
                                    uint64_t value, unsigned size)
 {
-//    S5L8950XPmgrState *s = (S5L8950XPmgrState *)opaque;
+    S5L8950XPmgrState *s = (S5L8950XPmgrState *)opaque;
+
+    trace_s5l8950x_pmgr_write(offset, value, size);
 
     switch (offset) {
+    case rPMGR_PLL_CTL0(0):
+    case rPMGR_PLL_CTL0(1):
+    case rPMGR_PLL_CTL0(2):
+    case rPMGR_PLL_CTL0(3):
+    case rPMGR_PLL_CTL0(4):
+    case rPMGR_PLL_CTL0(5):
+    case rPMGR_PLL_CTL0(6):
+    case rPMGR_PLL_CTL0(7):
+    case rPMGR_PLL_CTL0(8):
+        // The load bit self-clears once the new configuration is applied
+        s->pll_ctl0[offset / rPMGR_PLL_CTL0(1)] = value & ~(PMGR_PLL_LOAD | PMGR_PLL_REAL_LOCK);
+        break;
+    case rPMGR_SCRATCH(0) ... rPMGR_SCRATCH(S5L8950X_PMGR_NUM_SCRATCH - 1):
+        s->scratch[(offset - rPMGR_SCRATCH(0)) / 4] = value;
+        break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_pmgr_write: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
         break;
@@ -85,46 +113,46 @@ static const MemoryRegionOps s5l8950x_pmgr_ops = {
 //    .impl.max_access_size = 4,
 };
 
-//static const VMStateDescription vmstate_s5l8950x_pmgr = {
-//    .name = TYPE_S5L8950X_PMGR,
-//    .version_id = 1,
-//    .minimum_version_id = 1,
-//    .fields = (VMStateField[]) {
-//        VMSTATE_UINT32(rstc, S5L8950XPmgrState),
-//        VMSTATE_UINT32(rsts, S5L8950XPmgrState),
-//        VMSTATE_UINT32(wdog, S5L8950XPmgrState),
-//        VMSTATE_END_OF_LIST()
-//    }
-//};
+static const VMStateDescription vmstate_s5l8950x_pmgr = {
+    .name = TYPE_S5L8950X_PMGR,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32_ARRAY(pll_ctl0, S5L8950XPmgrState,
+                             S5L8950X_PMGR_NUM_PLLS),
+        VMSTATE_UINT32_ARRAY(scratch, S5L8950XPmgrState,
+                             S5L8950X_PMGR_NUM_SCRATCH),
+        VMSTATE_END_OF_LIST()
+    }
+};
 
 static void s5l8950x_pmgr_init(Object *obj)
 {
     S5L8950XPmgrState *s = S5L8950X_PMGR(obj);
 
-    printf("s5l8950x_pmgr_init\n");
     memory_region_init_io(&s->iomem, obj, &s5l8950x_pmgr_ops, s, TYPE_S5L8950X_PMGR, 0x100000);
     sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->iomem);
 }
 
 static void s5l8950x_pmgr_reset(DeviceState *dev)
 {
-//    S5L8950XPmgrState *s = S5L8950X_PMGR(dev);
+    S5L8950XPmgrState *s = S5L8950X_PMGR(dev);
 
-    printf("s5l8950x_pmgr_reset\n");
+    trace_s5l8950x_pmgr_reset();
 
-//    s->rstc = 0x00000102;
-//    s->rsts = 0x00001000;
-//    s->wdog = 0x00000000;
+    memset(s->pll_ctl0, 0, sizeof(s->pll_ctl0));
+    memset(s->scratch, 0, sizeof(s->scratch));
+
+    // boot_config_mask = 0xFF << 8
+    s->scratch[0] = 4 << 8; // FMI0 2 CS (First NAND entry, might not be the one that the iPhone 5 uses)
 }
 
 static void s5l8950x_pmgr_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
-    printf("s5l8950x_pmgr_class_init\n");
-
     dc->reset = s5l8950x_pmgr_reset;
-//    dc->vmsd = &vmstate_s5l8950x_pmgr;
+    dc->vmsd = &vmstate_s5l8950x_pmgr;
 }
 
 static const TypeInfo s5l8950x_pmgr_info = {
@@ -13,29 +13,78 @@
 #include "hw/ssi/s5l8950x-spi.h"
 #include "migration/vmstate.h"
 #include "sysemu/runstate.h"
+#include "trace.h"
+
+#define rSPICON         (0x00)
+#define rSPISETUP       (0x04)
+#define rSPISTATUS      (0x08)
+#define rSPIPIN         (0x0C)
+#define rSPICLKDIV      (0x30)
+#define rSPIRXCNT       (0x34)
 
 static uint64_t s5l8950x_spi_read(void *opaque, hwaddr offset,
                                       unsigned size)
 {
-//    S5L8950XSpiState *s = (S5L8950XSpiState *)opaque;
+    S5L8950XSpiState *s = (S5L8950XSpiState *)opaque;
     uint32_t res = 0;
 
     switch (offset) {
+    case rSPICON:
+        res = s->con;
+        break;
+    case rSPISETUP:
+        res = s->setup;
+        break;
+    case rSPISTATUS:
+        res = s->status;
+        break;
+    case rSPIPIN:
+        res = s->pin;
+        break;
+    case rSPICLKDIV:
+        res = s->clkdiv;
+        break;
+    case rSPIRXCNT:
+        res = s->rxcnt;
+        break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_spi_read: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
         res = 0;
         break;
     }
 
+    trace_s5l8950x_spi_read(DEVICE(s)->canonical_path, offset, res, size);
+
     return res;
 }
 
 static void s5l8950x_spi_write(void *opaque, hwaddr offset,
                                    uint64_t value, unsigned size)
 {
-//    S5L8950XSpiState *s = (S5L8950XSpiState *)opaque;
+    S5L8950XSpiState *s = (S5L8950XSpiState *)opaque;
+
+    trace_s5l8950x_spi_write(DEVICE(s)->canonical_path, offset, value, size);
 
     switch (offset) {
+    case rSPICON:
+        s->con = value;
+        break;
+    case rSPISETUP:
+        s->setup = value;
+        break;
+    case rSPISTATUS:
+        // Write 1 to clear
+        s->status &= ~value;
+        break;
+    case rSPIPIN:
+        s->pin = value;
+        break;
+    case rSPICLKDIV:
+        s->clkdiv = value;
+        break;
+    case rSPIRXCNT:
+        s->rxcnt = value;
+        break;
     default:
         qemu_log_mask(LOG_UNIMP, "s5l8950x_spi_write: Unknown offset 0x%08"HWADDR_PRIx"\n", offset);
         break;
@@ -50,46 +99,49 @@ static const MemoryRegionOps s5l8950x_spi_ops = {
 //    .impl.max_access_size = 4,
 };
 
-//static const VMStateDescription vmstate_s5l8950x_spi = {
-//    .name = TYPE_S5L8950X_SPI,
-//    .version_id = 1,
-//    .minimum_version_id = 1,
-//    .fields = (VMStateField[]) {
-//        VMSTATE_UINT32(rstc, S5L8950XSpiState),
-//        VMSTATE_UINT32(rsts, S5L8950XSpiState),
-//        VMSTATE_UINT32(wdog, S5L8950XSpiState),
-//        VMSTATE_END_OF_LIST()
-//    }
-//};
+static const VMStateDescription vmstate_s5l8950x_spi = {
+    .name = TYPE_S5L8950X_SPI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(con, S5L8950XSpiState),
+        VMSTATE_UINT32(setup, S5L8950XSpiState),
+        VMSTATE_UINT32(status, S5L8950XSpiState),
+        VMSTATE_UINT32(pin, S5L8950XSpiState),
+        VMSTATE_UINT32(clkdiv, S5L8950XSpiState),
+        VMSTATE_UINT32(rxcnt, S5L8950XSpiState),
+        VMSTATE_END_OF_LIST()
+    }
+};
 
 static void s5l8950x_spi_init(Object *obj)
 {
     S5L8950XSpiState *s = S5L8950X_SPI(obj);
 
-    printf("s5l8950x_spi_init\n");
     memory_region_init_io(&s->iomem, obj, &s5l8950x_spi_ops, s, TYPE_S5L8950X_SPI, 0x100000);
     sysbus_init_mmio(SYS_BUS_DEVICE(s), &s->iomem);
 }
 
 static void s5l8950x_spi_reset(DeviceState *dev)
 {
-//    S5L8950XSpiState *s = S5L8950X_SPI(dev);
+    S5L8950XSpiState *s = S5L8950X_SPI(dev);
 
-    printf("s5l8950x_spi_reset\n");
+    trace_s5l8950x_spi_reset(dev->canonical_path);
 
-//    s->rstc = 0x00000102;
-//    s->rsts = 0x00001000;
-//    s->wdog = 0x00000000;
+    s->con = 0;
+    s->setup = 0;
+    s->status = 0;
+    s->pin = 0;
+    s->clkdiv = 0;
+    s->rxcnt = 0;
 }
 
 static void s5l8950x_spi_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
-    printf("s5l8950x_spi_class_init\n");
-
     dc->reset = s5l8950x_spi_reset;
-//    dc->vmsd = &vmstate_s5l8950x_spi;
+    dc->vmsd = &vmstate_s5l8950x_spi;
 }
 
 static const TypeInfo s5l8950x_spi_info = {
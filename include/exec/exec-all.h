@@ -222,6 +222,80 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
                                                uint16_t idxmap,
                                                unsigned bits);
 
+/**
+ * tlb_flush_range_by_mmuidx_all_cpus_batched:
+ * @cpu: Originating CPU of the flush
+ * @addr: virtual address of the start of the range to be flushed
+ * @len: length of range to be flushed
+ * @idxmap: bitmap of mmu indexes to flush
+ * @bits: number of significant bits in address
+ *
+ * Like tlb_flush_range_by_mmuidx_all_cpus_synced, except that nothing
+ * is flushed until tlb_flush_batch_sync is called for @cpu.  In the
+ * meantime the range is merged with the other flushes batched by @cpu;
+ * if they get too scattered, the MMU indexes are flushed in full.
+ * Must be called on @cpu's own thread.
+ */
+void tlb_flush_range_by_mmuidx_all_cpus_batched(CPUState *cpu,
+                                                vaddr addr,
+                                                vaddr len,
+                                                uint16_t idxmap,
+                                                unsigned bits);
+/* Similarly, for all the entries of the MMU indexes in @idxmap. */
+void tlb_flush_by_mmuidx_all_cpus_batched(CPUState *cpu, uint16_t idxmap);
+
+/**
+ * tlb_flush_batch_sync:
+ * @cpu: Originating CPU of the batched flushes
+ *
+ * Issue the flushes batched by @cpu on all CPUs, with the single
+ * synchronisation point of one tlb_flush_*_all_cpus_synced call.
+ * Returns true if there was anything to flush; the flushes are then
+ * complete once @cpu has left the current TB.
+ */
+bool tlb_flush_batch_sync(CPUState *cpu);
+
+/**
+ * tlb_flush_generation:
+ * @cpu: CPU whose TLB is queried
+ *
+ * Return a value that changes whenever any entry of @cpu's TLB may have
+ * been flushed, by any of the flush functions above, or switched over to
+ * another ASID by tlb_switch_asid(). Targets use this to
+ * drop their own translation caches (e.g. page-table walk caches) in step
+ * with the TLB. Only meaningful on @cpu's own thread.
+ */
+size_t tlb_flush_generation(CPUState *cpu);
+
+/**
+ * tlb_switch_asid:
+ * @cpu: CPU whose TLB is switched
+ * @idxmap: bitmap of MMU indexes whose entries are ASID tagged
+ * @asid: the new address space identifier
+ *
+ * Switch the entries of the MMU indexes in @idxmap over to @asid, in
+ * place of flushing them.  The current entries are parked in a bank
+ * tagged with the previous ASID and the entries of @asid are restored
+ * if they are still parked.  Flushes of any kind also apply to the
+ * parked entries, so the target only needs to call this where it would
+ * otherwise flush @idxmap for an ASID change.  The first call, and any
+ * call with a different @idxmap, flushes @idxmap instead.
+ * Must be called on @cpu's own thread.
+ */
+void tlb_switch_asid(CPUState *cpu, uint16_t idxmap, uint32_t asid);
+
+/**
+ * tlb_reset_asid:
+ * @cpu: CPU whose TLB is reset
+ *
+ * Drop all the parked banks and forget the current ASID, so that the
+ * next tlb_switch_asid() flushes instead of trusting the tags.  Called
+ * when the register holding the ASID changes without the target being
+ * told, such as on reset or when loading a snapshot.  @cpu must not be
+ * running.
+ */
+void tlb_reset_asid(CPUState *cpu);
+
 /**
  * tlb_set_page_full:
  * @cpu: CPU context
@@ -365,6 +439,31 @@ static inline void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *cpu,
                                                              unsigned bits)
 {
 }
+static inline void
+tlb_flush_range_by_mmuidx_all_cpus_batched(CPUState *cpu, vaddr addr,
+                                           vaddr len, uint16_t idxmap,
+                                           unsigned bits)
+{
+}
+static inline void tlb_flush_by_mmuidx_all_cpus_batched(CPUState *cpu,
+                                                        uint16_t idxmap)
+{
+}
+static inline bool tlb_flush_batch_sync(CPUState *cpu)
+{
+    return false;
+}
+static inline size_t tlb_flush_generation(CPUState *cpu)
+{
+    return 0;
+}
+static inline void tlb_switch_asid(CPUState *cpu, uint16_t idxmap,
+                                   uint32_t asid)
+{
+}
+static inline void tlb_reset_asid(CPUState *cpu)
+{
+}
 #endif
 /**
  * probe_access:
@@ -38,6 +38,9 @@ struct tb_tc {
     size_t size;
 };
 
+/* Maximum number of blocks a CF_TRACE TB continues into. */
+#define TB_TRACE_MAX 4
+
 struct TranslationBlock {
     /*
      * Guest PC corresponding to this block.  This must be the true
@@ -77,6 +80,7 @@ struct TranslationBlock {
 #define CF_PARALLEL      0x00008000 /* Generate code for a parallel context */
 #define CF_NOIRQ         0x00010000 /* Generate an uninterruptible TB */
 #define CF_PCREL         0x00020000 /* Opcodes in TB are PC-relative */
+#define CF_TRACE         0x00040000 /* Hot trace, not part of the lookup key */
 #define CF_CLUSTER_MASK  0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 
@@ -88,6 +92,26 @@ struct TranslationBlock {
     uint16_t size;
     uint16_t icount;
 
+    /*
+     * Executions left before the TB is retranslated as a CF_TRACE block,
+     * counted down by the generated code when tb-hot-threshold is set.
+     */
+    int32_t hot_count;
+
+    /*
+     * Counters for "info tb-profile", updated without atomics by the
+     * generated code when tb-profile is enabled: entries into the block,
+     * goto_tb exits and how many of those were not chained, exits through
+     * lookup_and_goto_ptr and exits to the main loop.
+     */
+    struct {
+        uint64_t exec;
+        uint64_t goto_tb;
+        uint64_t unchained;
+        uint64_t lookup;
+        uint64_t exit;
+    } prof;
+
     struct tb_tc tc;
 
     /*
@@ -20,6 +20,7 @@
 
 #include "qemu/bswap.h"
 #include "exec/cpu_ldst.h"	/* for abi_ptr */
+#include "tcg/tcg.h"
 
 /**
  * gen_intermediate_code
@@ -74,6 +75,9 @@ typedef enum DisasJumpType {
  * @singlestep_enabled: "Hardware" single stepping enabled.
  * @saved_can_do_io: Known value of cpu->neg.can_do_io, or -1 for unknown.
  * @plugin_enabled: TCG plugin enabled in this TB.
+ * @trace: For a CF_TRACE TB, the starts of the blocks to continue into.
+ * @trace_len: Number of valid entries in @trace.
+ * @trace_idx: Next entry of @trace to be followed.
  *
  * Architecture-agnostic disassembly context.
  */
@@ -88,6 +92,9 @@ typedef struct DisasContextBase {
     int8_t saved_can_do_io;
     bool plugin_enabled;
     void *host_addr[2];
+    vaddr trace[TB_TRACE_MAX];
+    int trace_len;
+    int trace_idx;
 } DisasContextBase;
 
 /**
@@ -159,6 +166,43 @@ void translator_loop(CPUState *cpu, TranslationBlock *tb, int *max_insns,
  */
 bool translator_use_goto_tb(DisasContextBase *db, vaddr dest);
 
+/**
+ * translator_trace_follow
+ * @db: Disassembly context
+ * @dest: target pc of a direct branch
+ *
+ * Return true if the current TB is a hot trace that continues at @dest,
+ * in which case translation should carry on with the insn at @dest
+ * instead of ending the TB.  Only forward branches within the page of
+ * the TB are followed, so that the TB still covers all of its code.
+ */
+bool translator_trace_follow(DisasContextBase *db, vaddr dest);
+
+/**
+ * translator_goto_ptr_cached
+ * @db: Disassembly context
+ * @key: value the branch takes the target from
+ * @ret: the branch is a function return
+ *
+ * End the TB like tcg_gen_lookup_and_goto_ptr(), but first compare @key
+ * inline against the last one seen by this branch and jump straight to
+ * the TB found then.  For @ret, compare against the entry of the call
+ * site on top of the return stack instead, see translator_push_return().
+ *
+ * @key together with the TB flags must determine the state that the
+ * target is looked up with: e.g. it must include any interworking bit.
+ */
+void translator_goto_ptr_cached(DisasContextBase *db, TCGv_i64 key, bool ret);
+
+/**
+ * translator_push_return
+ * @db: Disassembly context
+ *
+ * Note on the return stack that the current insn calls a function, for
+ * the translator_goto_ptr_cached() that returns from it.
+ */
+void translator_push_return(DisasContextBase *db);
+
 /**
  * translator_io_start
  * @db: Disassembly context
@@ -19,6 +19,7 @@
 #include "hw/misc/s5l8950x-pmgr.h"
 #include "sysemu/block-backend.h"
 #include "hw/misc/s5l8950x-chipid.h"
+#include "hw/audio/s5l8950x-audio.h"
 
 /**
  * S5L8950X device list
@@ -150,6 +151,7 @@ struct S5L8950XState {
     S5L8950XGpioState gpio;
     S5L8950XPmgrState pmgr;
     S5L8950XChipIdState chipid;
+    S5L8950XAudioState audio;
 };
 
 #endif /* HW_ARM_S5L8950X_H */
@@ -0,0 +1,54 @@
+/*
+ * Apple A6 (S5L8950X) audio (I2S) emulation
+ *
+ * Copyright (C) 2024 Iscle <albertiscle9@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef HW_AUDIO_S5L8950X_AUDIO_H
+#define HW_AUDIO_S5L8950X_AUDIO_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "audio/audio.h"
+#include "exec/memory.h"
+#include "qemu/timer.h"
+
+#define TYPE_S5L8950X_AUDIO   "s5l8950x-audio"
+OBJECT_DECLARE_SIMPLE_TYPE(S5L8950XAudioState, S5L8950X_AUDIO)
+
+#define S5L8950X_AUDIO_BUF_SIZE   (4096)
+
+struct S5L8950XAudioState {
+    /*< private >*/
+    SysBusDevice parent_obj;
+
+    /*< public >*/
+    MemoryRegion iomem;
+    qemu_irq irq;
+
+    MemoryRegion *dma_mr;
+    AddressSpace dma_as;
+
+    QEMUSoundCard card;
+    SWVoiceOut *voice;
+    uint32_t voice_rate;
+    QEMUTimer *timer;
+    uint8_t buf[S5L8950X_AUDIO_BUF_SIZE];
+
+    uint32_t ctrl;
+    uint32_t rate;
+    uint32_t int_en;
+    uint32_t dma_addr;
+    uint32_t dma_len;
+    uint32_t dma_status;
+    uint32_t dma_pos;
+    int64_t dma_start_ns;
+
+    /* Properties */
+    bool null_sink;
+};
+
+#endif /* HW_AUDIO_S5L8950X_AUDIO_H */
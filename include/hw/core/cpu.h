@@ -202,6 +202,12 @@ struct CPUClass {
 /* Use a fully associative victim tlb of 8 entries. */
 #define CPU_VTLB_SIZE 8
 
+/* Number of parked per-ASID tlb banks, see tlb_switch_asid(). */
+#define CPU_TLB_BANKS 8
+
+/* Number of separately tracked large page regions per mmu mode. */
+#define CPU_TLB_LARGE_PAGES 8
+
 /*
  * The full TLB entry, which is not accessed by generated TCG code,
  * so the layout is not as critical as that of CPUTLBEntry. This is
@@ -262,19 +268,27 @@ typedef struct CPUTLBEntryFull {
     } extra;
 } CPUTLBEntryFull;
 
+/*
+ * A region covering one or more of the large pages allocated into the
+ * tlb.  Address @x is within the region if (x & mask) == addr.
+ */
+typedef struct CPUTLBLargePage {
+    vaddr addr;
+    vaddr mask;
+} CPUTLBLargePage;
+
 /*
  * Data elements that are per MMU mode, minus the bits accessed by
  * the TCG fast path.
  */
 typedef struct CPUTLBDesc {
     /*
-     * Describe a region covering all of the large pages allocated
-     * into the tlb.  When any page within this region is flushed,
-     * we must flush the entire tlb.  The region is matched if
-     * (addr & large_page_mask) == large_page_addr.
+     * Describe the regions covering the large pages allocated into the
+     * tlb.  When any page within a region is flushed, we must flush all
+     * the entries within that region.
      */
-    vaddr large_page_addr;
-    vaddr large_page_mask;
+    CPUTLBLargePage large_page[CPU_TLB_LARGE_PAGES];
+    unsigned n_large_pages;
     /* host time (in ns) at the beginning of the time window */
     int64_t window_begin_ns;
     /* maximum number of entries observed in the window */
@@ -288,6 +302,9 @@ typedef struct CPUTLBDesc {
     CPUTLBEntryFull *fulltlb;
 } CPUTLBDesc;
 
+typedef struct CPUTLBBank CPUTLBBank;
+typedef struct CPUTLBFlushBatch CPUTLBFlushBatch;
+
 /*
  * Data elements that are shared between all MMU modes.
  */
@@ -300,6 +317,22 @@ typedef struct CPUTLBCommon {
      * Protected by tlb_c.lock.
      */
     uint16_t dirty;
+    /*
+     * ASID tagging, see tlb_switch_asid().  When asid_valid is set, the
+     * live entries of the mmu_idx in asid_idxmap all belong to asid, and
+     * banks holds the tables of up to CPU_TLB_BANKS other ASIDs.
+     * Only modified by the owning cpu; banks is protected by tlb_c.lock.
+     */
+    uint16_t asid_idxmap;
+    bool asid_valid;
+    uint32_t asid;
+    uint64_t asid_seq;
+    CPUTLBBank *banks;
+    /*
+     * Broadcast flushes held back until tlb_flush_batch_sync().
+     * Only accessed by the owning cpu.
+     */
+    CPUTLBFlushBatch *batch;
     /*
      * Statistics.  These are not lock protected, but are read and
      * written atomically.  This allows the monitor to print a snapshot
@@ -308,6 +341,9 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t page_flush_count;
+    size_t asid_hit_count;
+    size_t asid_miss_count;
 } CPUTLBCommon;
 
 /*
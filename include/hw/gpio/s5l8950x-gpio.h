@@ -14,6 +14,15 @@
 #include "qom/object.h"
 
 #define TYPE_S5L8950X_GPIO   "s5l8950x-gpio"
+
+#define S5L8950X_GPIO_PAD_PINS  (8)
+#define S5L8950X_GPIO_NUM_PADS  (32)
+#define S5L8950X_GPIO_NUM_PINS  (S5L8950X_GPIO_NUM_PADS * S5L8950X_GPIO_PAD_PINS)
+#define S5L8950X_GPIO_NUM_INT   (S5L8950X_GPIO_NUM_PINS / 32)
+
+/* gpion = pad * S5L8950X_GPIO_PAD_PINS + pin */
+#define S5L8950X_GPIO(pad, pin) ((pad) * S5L8950X_GPIO_PAD_PINS + (pin))
+
 OBJECT_DECLARE_SIMPLE_TYPE(S5L8950XGpioState, S5L8950X_GPIO)
 
 struct S5L8950XGpioState {
@@ -22,6 +31,14 @@ struct S5L8950XGpioState {
 
     /*< public >*/
     MemoryRegion iomem;
+
+    uint32_t cfg[S5L8950X_GPIO_NUM_PINS];
+    uint32_t int_status[S5L8950X_GPIO_NUM_INT];
+
+    /* Properties */
+    uint32_t board_id;
+    uint32_t num_board_id_pins;
+    uint32_t *board_id_pins;
 };
 
 #endif /* HW_MISC_S5L8950X_GPIO_H */
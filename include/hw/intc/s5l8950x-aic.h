@@ -14,6 +14,10 @@
 #include "qom/object.h"
 
 #define TYPE_S5L8950X_AIC   "s5l8950x-aic"
+
+#define S5L8950X_AIC_NUM_IRQS   (192)
+#define S5L8950X_AIC_NUM_EIR    (S5L8950X_AIC_NUM_IRQS / 32)
+
 OBJECT_DECLARE_SIMPLE_TYPE(S5L8950XAicState, S5L8950X_AIC)
 
 struct S5L8950XAicState {
@@ -22,7 +26,13 @@ struct S5L8950XAicState {
 
     /*< public >*/
     MemoryRegion iomem;
-    uint32_t time_lo;
+
+    uint32_t glb_cfg;
+    uint32_t ipi_pending;
+    uint32_t ipi_mask;
+    uint32_t eir_dest[S5L8950X_AIC_NUM_IRQS];
+    uint32_t eir_sw_pending[S5L8950X_AIC_NUM_EIR];
+    uint32_t eir_mask[S5L8950X_AIC_NUM_EIR];
 };
 
 #endif /* HW_MISC_S5L8950X_AIC_H */
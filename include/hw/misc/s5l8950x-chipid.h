@@ -14,6 +14,9 @@
 #include "qom/object.h"
 
 #define TYPE_S5L8950X_CHIPID   "s5l8950x-chipid"
+
+#define S5L8950X_CHIPID_NUM_CFG_FUSES   (6)
+
 OBJECT_DECLARE_SIMPLE_TYPE(S5L8950XChipIdState, S5L8950X_CHIPID)
 
 struct S5L8950XChipIdState {
@@ -22,6 +25,9 @@ struct S5L8950XChipIdState {
 
     /*< public >*/
     MemoryRegion iomem;
+
+    uint32_t cfg_fuse[S5L8950X_CHIPID_NUM_CFG_FUSES];
+    uint64_t ecid;
 };
 
 #endif /* HW_MISC_S5L8950X_CHIPID_H */
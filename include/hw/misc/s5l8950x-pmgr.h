@@ -14,6 +14,10 @@
 #include "qom/object.h"
 
 #define TYPE_S5L8950X_PMGR   "s5l8950x-pmgr"
+
+#define S5L8950X_PMGR_NUM_PLLS      (9)
+#define S5L8950X_PMGR_NUM_SCRATCH   (16)
+
 OBJECT_DECLARE_SIMPLE_TYPE(S5L8950XPmgrState, S5L8950X_PMGR)
 
 struct S5L8950XPmgrState {
@@ -22,6 +26,9 @@ struct S5L8950XPmgrState {
 
     /*< public >*/
     MemoryRegion iomem;
+
+    uint32_t pll_ctl0[S5L8950X_PMGR_NUM_PLLS];
+    uint32_t scratch[S5L8950X_PMGR_NUM_SCRATCH];
 };
 
 #endif /* HW_MISC_S5L8950X_PMGR_H */
@@ -22,6 +22,13 @@ struct S5L8950XSpiState {
 
     /*< public >*/
     MemoryRegion iomem;
+
+    uint32_t con;
+    uint32_t setup;
+    uint32_t status;
+    uint32_t pin;
+    uint32_t clkdiv;
+    uint32_t rxcnt;
 };
 
 #endif /* HW_MISC_S5L8950X_SPI_H */
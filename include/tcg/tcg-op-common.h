@@ -74,6 +74,15 @@ void tcg_gen_goto_tb(unsigned idx);
  */
 void tcg_gen_lookup_and_goto_ptr(void);
 
+/**
+ * tcg_gen_goto_ptr() - jump to the host code of a TB
+ * @ptr: host code pointer, as returned by the lookup_tb_ptr helper
+ *
+ * The building block of tcg_gen_lookup_and_goto_ptr(), for translators
+ * that find the TB some other way first.  The same restrictions apply.
+ */
+void tcg_gen_goto_ptr(TCGv_ptr ptr);
+
 void tcg_gen_plugin_cb_start(unsigned from, unsigned type, unsigned wr);
 void tcg_gen_plugin_cb_end(void);
 
@@ -491,6 +491,7 @@ struct TCGContext {
     uint8_t tlb_dyn_max_bits;
     uint8_t insn_start_words;
     TCGBar guest_mo;
+    bool tb_profile;              /* count events in gen_tb->prof */
 
     TCGRegSet reserved_regs;
     intptr_t current_frame_offset;
@@ -755,6 +756,7 @@ void tcg_pool_reset(TCGContext *s);
 TranslationBlock *tcg_tb_alloc(TCGContext *s);
 
 void tcg_region_reset_all(void);
+bool tcg_region_reclaim(GFunc func, gpointer user_data);
 
 size_t tcg_code_size(void);
 size_t tcg_code_capacity(void);
@@ -183,7 +183,11 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                kernel-irqchip=on|off|split controls accelerated irqchip support (default=on)\n"
     "                kvm-shadow-mem=size of KVM shadow MMU in bytes\n"
     "                one-insn-per-tb=on|off (one guest instruction per TCG translation block)\n"
+    "                spec-translate=on|off (translate TCG branch targets ahead in a thread)\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
+    "                tb-cache=file (remember TCG translated blocks across runs)\n"
+    "                tb-hot-threshold=n (retranslate TCG blocks as traces after n runs)\n"
+    "                tb-profile=on|off (count executions and exits of TCG blocks)\n"
     "                tb-size=n (TCG translation block cache size)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                eager-split-size=n (KVM Eager Page Split chunk size, default 0, disabled. ARM only)\n"
@@ -218,12 +222,45 @@ SRST
         can be useful in some situations, such as when trying to analyse
         the logs produced by the ``-d`` option.
 
+    ``spec-translate=on|off``
+        Makes the TCG accelerator translate ahead, in a background thread,
+        the targets of the direct branches of each newly translated block,
+        including the continuation into the next page. This takes
+        translation off the critical path when a lot of code runs for the
+        first time, such as during boot, at the cost of one more host
+        thread and of translating some code that never runs. The default
+        is off.
+
     ``split-wx=on|off``
         Controls the use of split w^x mapping for the TCG code generation
         buffer. Some operating systems require this to be enabled, and in
         such a case this will default on. On other operating systems, this
         will default off, but one may enable this for testing or debugging.
 
+    ``tb-cache=file``
+        Makes the TCG accelerator remember in ``file`` which blocks were
+        translated on each guest physical page. On the next run, when one
+        of those pages is first executed and its contents are unchanged,
+        all the blocks recorded for it are translated in one go. Only
+        hints are stored, never host code, so a stale file is harmless.
+        The file is written when QEMU exits.
+
+    ``tb-hot-threshold=n``
+        Makes the TCG accelerator count how many times each translation
+        block is entered. Once a block has run ``n`` times it is
+        translated again, this time continuing through the forward
+        branches that were taken most often, so that a hot path within
+        a guest page becomes a single block. The default of 0 disables
+        this. Currently only AArch32 code is extended into traces.
+
+    ``tb-profile=on|off``
+        Makes the TCG accelerator count, for each translation block, how
+        many times it was entered and how it was left: through a chained
+        jump, through a jump cache lookup or back to the main loop. The
+        counters are reported by the ``info tb-profile`` monitor command.
+        They cost a few host instructions per block, and are approximate
+        when several vCPU threads run the same block. The default is off.
+
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
@@ -118,6 +118,18 @@ enum {
      * ARM pseudocode function CheckSMEAccess().
      */
     ARM_CP_SME                   = 1 << 19,
+    /*
+     * Flag: Cache maintenance operation whose accessfn can only UNDEF at
+     * EL0 or trap to EL2. At EL1 and above on a CPU without EL2 the check
+     * always passes, so the translator drops it and the op costs nothing.
+     */
+    ARM_CP_CACHE_MAINT           = 1 << 20,
+    /*
+     * Flag: AArch32 TLB invalidate by MVA of a single page in all
+     * translation regimes. Runs of these are coalesced into one range
+     * flush, see HELPER(tlbi_batch_page).
+     */
+    ARM_CP_TLBI_BATCH            = 1 << 21,
 };
 
 /*
@@ -982,6 +994,57 @@ void define_arm_cp_regs_with_opaque_len(ARMCPU *cpu, const ARMCPRegInfo *regs,
 
 const ARMCPRegInfo *get_arm_cp_reginfo(GHashTable *cpregs, uint32_t encoded_cp);
 
+/*
+ * Direct-mapped view of the AArch32 32-bit cp15 register space, which
+ * is where nearly all MRC/MCR traffic from guest code goes (cache and
+ * TLB maintenance in particular). Each (ns, crn, crm, opc1, opc2)
+ * tuple owns a slot in @index holding a 1-based index into @regs, or 0
+ * if no register is defined there. The table mirrors cp_regs, which
+ * remains the authority for all other keys.
+ */
+#define ARM_CP15_TABLE_SIZE (1 << 15)
+
+typedef struct ARMCP15Table {
+    GPtrArray *regs;
+    uint16_t index[ARM_CP15_TABLE_SIZE];
+} ARMCP15Table;
+
+void arm_cp15_table_insert(ARMCP15Table *table, uint32_t encoded_cp,
+                           const ARMCPRegInfo *ri);
+
+/*
+ * Return the ARMCP15Table slot for @encoded_cp, or -1 if the key is not
+ * a 32-bit cp15 register. The 3 bit opc1 of such keys leaves bit 6 of
+ * the encoding clear, which is squeezed out along with cp and is64.
+ */
+static inline int arm_cp15_table_slot(uint32_t encoded_cp)
+{
+    if ((encoded_cp & ~(CP_REG_NS_MASK | 0x7fbf)) != (15 << 16)) {
+        return -1;
+    }
+    return extract32(encoded_cp, CP_REG_NS_SHIFT, 1) << 14 |
+           extract32(encoded_cp, 7, 8) << 6 |
+           extract32(encoded_cp, 0, 6);
+}
+
+/*
+ * Look up @encoded_cp through @table when it covers the key, and fall
+ * back to the @cpregs hashtable otherwise. @table may be NULL.
+ */
+static inline const ARMCPRegInfo *
+get_arm_cp_reginfo_fast(GHashTable *cpregs, const ARMCP15Table *table,
+                        uint32_t encoded_cp)
+{
+    int slot = arm_cp15_table_slot(encoded_cp);
+
+    if (table && slot >= 0) {
+        uint16_t idx = table->index[slot];
+
+        return idx ? g_ptr_array_index(table->regs, idx - 1) : NULL;
+    }
+    return get_arm_cp_reginfo(cpregs, encoded_cp);
+}
+
 /*
  * Definition of an ARM co-processor register as viewed from
  * userspace. This is used for presenting sanitised versions of
@@ -542,6 +542,10 @@ static void arm_cpu_reset_hold(Object *obj)
                               &env->vfp.fp_status_f16);
     set_float_detect_tininess(float_tininess_before_rounding,
                               &env->vfp.standard_fp_status_f16);
+    if (cpu->vfp_hardfloat) {
+        /* Re-raise the sticky inexact flag cleared by the reset above */
+        vfp_set_fpscr(env, vfp_get_fpscr(env));
+    }
 #ifndef CONFIG_USER_ONLY
     if (kvm_enabled()) {
         kvm_arm_reset_vcpu(cpu);
@@ -551,6 +555,8 @@ static void arm_cpu_reset_hold(Object *obj)
     if (tcg_enabled()) {
         hw_breakpoint_update_all(cpu);
         hw_watchpoint_update_all(cpu);
+        /* CONTEXTIDR was reset without going through its writefn */
+        tlb_reset_asid(s);
 
         arm_rebuild_hflags(env);
     }
@@ -1348,6 +1354,16 @@ static void arm_cpu_initfn(Object *obj)
                              "gicv3-maintenance-interrupt", 1);
     qdev_init_gpio_out_named(DEVICE(cpu), &cpu->pmu_interrupt,
                              "pmu-interrupt", 1);
+
+    object_property_add_uint64_ptr(obj, "x-walk-cache-walks",
+                                   &cpu->walk_cache.walks,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "x-walk-cache-hits",
+                                   &cpu->walk_cache.hits,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "x-walk-cache-misses",
+                                   &cpu->walk_cache.misses,
+                                   OBJ_PROP_FLAG_READ);
 #endif
 
     /* DTB consumers generally don't in fact care what the 'compatible'
@@ -1715,6 +1731,10 @@ static void arm_cpu_finalizefn(Object *obj)
     ARMELChangeHook *hook, *next;
 
     g_hash_table_destroy(cpu->cp_regs);
+    if (cpu->cp15_table) {
+        g_ptr_array_free(cpu->cp15_table->regs, true);
+        g_free(cpu->cp15_table);
+    }
 
     QLIST_FOREACH_SAFE(hook, &cpu->pre_el_change_hooks, node, next) {
         QLIST_REMOVE(hook, node);
@@ -2319,6 +2339,7 @@ static void arm_cpu_realizefn(DeviceState *dev, Error **errp)
     arm_cpu_register_gdb_regs_for_features(cpu);
 
     init_cpreg_list(cpu);
+    init_cp15_table(cpu);
 
 #ifndef CONFIG_USER_ONLY
     MachineState *ms = MACHINE(qdev_get_machine());
@@ -2423,6 +2444,7 @@ static Property arm_cpu_properties[] = {
                         mp_affinity, ARM64_AFFINITY_INVALID),
     DEFINE_PROP_INT32("node-id", ARMCPU, node_id, CPU_UNSET_NUMA_NODE_ID),
     DEFINE_PROP_INT32("core-count", ARMCPU, core_count, -1),
+    DEFINE_PROP_BOOL("x-vfp-hardfloat", ARMCPU, vfp_hardfloat, false),
     DEFINE_PROP_END_OF_LIST()
 };
 
@@ -743,6 +743,16 @@ typedef struct CPUArchState {
     /* Optional fault info across tlb lookup. */
     ARMMMUFaultInfo *tlb_fi;
 
+    /*
+     * Pending AArch32 TLBIMVA range; nothing is pending when len is 0.
+     * bcast is set while IS invalidations are batched in the cputlb.
+     */
+    struct {
+        uint32_t addr;
+        uint32_t len;
+        uint32_t bcast;
+    } tlbi_batch;
+
     /* Fields up to this point are cleared by a CPU reset */
     struct {} end_reset_fields;
 
@@ -845,6 +855,25 @@ typedef struct {
     uint32_t map, init, supported;
 } ARMVQMap;
 
+/*
+ * Page-table walk cache: valid table descriptors from the short-descriptor
+ * and LPAE walkers, keyed by descriptor address. See ptw.c.
+ */
+#define ARM_WALK_CACHE_SIZE 128
+
+typedef struct ARMWalkCache {
+    struct {
+        uint64_t key;
+        uint64_t desc;
+    } entries[ARM_WALK_CACHE_SIZE];
+    /* tlb_flush_generation() the entries are valid for */
+    size_t tlb_gen;
+    /* Statistics, readable as CPU properties */
+    uint64_t walks;
+    uint64_t hits;
+    uint64_t misses;
+} ARMWalkCache;
+
 /**
  * ARMCPU:
  * @env: #CPUARMState
@@ -858,6 +887,9 @@ struct ArchCPU {
 
     /* Coprocessor information */
     GHashTable *cp_regs;
+    /* Direct-mapped cp15 view of cp_regs, built at realize */
+    struct ARMCP15Table *cp15_table;
+    ARMWalkCache walk_cache;
     /* For marshalling (mostly coprocessor) register state between the
      * kernel and QEMU (for KVM) and between two QEMUs (for migration),
      * we use these arrays.
@@ -931,6 +963,11 @@ struct ArchCPU {
     bool has_vfp_d32;
     /* CPU has Neon */
     bool has_neon;
+    /*
+     * Let softfloat use the host FPU by keeping the inexact flag raised;
+     * FPSCR.IXC then only reflects guest writes. See vfp_helper.c.
+     */
+    bool vfp_hardfloat;
     /* CPU has M-profile DSP extension */
     bool has_dsp;
 
@@ -1838,6 +1875,7 @@ void vfp_set_fpscr(CPUARMState *env, uint32_t val);
 #define FPCR_OFE    (1 << 10)   /* Overflow exception trap enable */
 #define FPCR_UFE    (1 << 11)   /* Underflow exception trap enable */
 #define FPCR_IXE    (1 << 12)   /* Inexact exception trap enable */
+#define FPCR_IXC    (1 << 4)    /* Cumulative inexact flag */
 #define FPCR_IDE    (1 << 15)   /* Input Denormal exception trap enable */
 #define FPCR_FZ16   (1 << 19)   /* ARMv8.2+, FP16 flush-to-zero */
 #define FPCR_RMODE_MASK (3 << 22) /* Rounding mode */
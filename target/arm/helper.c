@@ -263,6 +263,51 @@ void init_cpreg_list(ARMCPU *cpu)
     g_list_free(keys);
 }
 
+void arm_cp15_table_insert(ARMCP15Table *table, uint32_t encoded_cp,
+                           const ARMCPRegInfo *ri)
+{
+    int slot = arm_cp15_table_slot(encoded_cp);
+
+    if (slot < 0) {
+        return;
+    }
+    if (table->index[slot]) {
+        /* Redefinition; cp_regs has already freed the old entry */
+        g_ptr_array_index(table->regs, table->index[slot] - 1) = (gpointer)ri;
+    } else {
+        g_ptr_array_add(table->regs, (gpointer)ri);
+        assert(table->regs->len <= UINT16_MAX);
+        table->index[slot] = table->regs->len;
+    }
+}
+
+static void add_cpreg_to_cp15_table(gpointer key, gpointer value,
+                                    gpointer opaque)
+{
+    arm_cp15_table_insert(opaque, (uintptr_t)key, value);
+}
+
+void init_cp15_table(ARMCPU *cpu)
+{
+    /*
+     * Build the direct-mapped cp15 table from the cp_regs hash. Registers
+     * defined after this point (e.g. by the GIC CPU interface) are added
+     * to it by add_cpreg_to_hashtable().
+     */
+    ARMCP15Table *table = g_new0(ARMCP15Table, 1);
+
+    table->regs = g_ptr_array_new();
+    g_hash_table_foreach(cpu->cp_regs, add_cpreg_to_cp15_table, table);
+
+    if (table->regs->len == 0) {
+        /* AArch64-only core, nothing to speed up */
+        g_ptr_array_free(table->regs, true);
+        g_free(table);
+        return;
+    }
+    cpu->cp15_table = table;
+}
+
 /*
  * Some registers are not accessible from AArch32 EL3 if SCR.NS == 0.
  */
@@ -408,6 +453,37 @@ static void fcse_write(CPUARMState *env, const ARMCPRegInfo *ri, uint64_t value)
     }
 }
 
+/*
+ * Return the mmu_idx whose translations are tagged by the ASID in the
+ * CONTEXTIDR bank @ri, or 0 if an ASID change must flush the whole TLB.
+ * Only the AArch32 PL1&0 regime of the current security state is
+ * handled: the other bank is not in use, and with EL2 the stage 2
+ * and EL2 regimes would need tagging with the VMID as well.
+ */
+static uint16_t contextidr_asid_idxmap(CPUARMState *env,
+                                       const ARMCPRegInfo *ri)
+{
+    uint16_t idxmap = ARMMMUIdxBit_E10_0 | ARMMMUIdxBit_E10_1 |
+                      ARMMMUIdxBit_E10_1_PAN;
+    bool bank_s;
+
+    if (arm_feature(env, ARM_FEATURE_EL2)) {
+        return 0;
+    }
+    if (!arm_feature(env, ARM_FEATURE_EL3)) {
+        return idxmap;
+    }
+    if (arm_el_is_aa64(env, 3)) {
+        return 0;
+    }
+    bank_s = ri->fieldoffset == offsetof(CPUARMState, cp15.contextidr_s);
+    if (bank_s != arm_is_secure_below_el3(env)) {
+        return 0;
+    }
+    /* Secure PL1 runs at EL3 with an AArch32 EL3 */
+    return bank_s ? idxmap | ARMMMUIdxBit_E3 : idxmap;
+}
+
 static void contextidr_write(CPUARMState *env, const ARMCPRegInfo *ri,
                              uint64_t value)
 {
@@ -417,10 +493,17 @@ static void contextidr_write(CPUARMState *env, const ARMCPRegInfo *ri,
         && !extended_addresses_enabled(env)) {
         /*
          * For VMSA (when not using the LPAE long descriptor page table
-         * format) this register includes the ASID, so do a TLB flush.
+         * format) this register includes the ASID, so switch the TLB
+         * over to the new ASID, or do a TLB flush if it can't be tagged.
          * For PMSA it is purely a process ID and no action is needed.
          */
-        tlb_flush(CPU(cpu));
+        uint16_t idxmap = contextidr_asid_idxmap(env, ri);
+
+        if (idxmap) {
+            tlb_switch_asid(CPU(cpu), idxmap, value & 0xff);
+        } else {
+            tlb_flush(CPU(cpu));
+        }
     }
     raw_write(env, ri, value);
 }
@@ -440,13 +523,19 @@ static int alle1_tlbmask(CPUARMState *env)
 }
 
 
-/* IS variants of TLB operations must affect all cores */
+/*
+ * IS variants of TLB operations must affect all cores. Rather than
+ * synchronizing with the other cores for each of them, they are batched
+ * in the cputlb until the next DSB, ISB or exception entry, where
+ * arm_tlbi_batch_flush() issues them all at once.
+ */
 static void tlbiall_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
                              uint64_t value)
 {
     CPUState *cs = env_cpu(env);
 
-    tlb_flush_all_cpus_synced(cs);
+    tlb_flush_by_mmuidx_all_cpus_batched(cs, (1 << NB_MMU_MODES) - 1);
+    env->tlbi_batch.bcast = 1;
 }
 
 static void tlbiasid_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
@@ -454,7 +543,8 @@ static void tlbiasid_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
 {
     CPUState *cs = env_cpu(env);
 
-    tlb_flush_all_cpus_synced(cs);
+    tlb_flush_by_mmuidx_all_cpus_batched(cs, (1 << NB_MMU_MODES) - 1);
+    env->tlbi_batch.bcast = 1;
 }
 
 static void tlbimva_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
@@ -462,7 +552,11 @@ static void tlbimva_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
 {
     CPUState *cs = env_cpu(env);
 
-    tlb_flush_page_all_cpus_synced(cs, value & TARGET_PAGE_MASK);
+    tlb_flush_range_by_mmuidx_all_cpus_batched(cs, value & TARGET_PAGE_MASK,
+                                               TARGET_PAGE_SIZE,
+                                               (1 << NB_MMU_MODES) - 1,
+                                               TARGET_LONG_BITS);
+    env->tlbi_batch.bcast = 1;
 }
 
 static void tlbimvaa_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
@@ -470,7 +564,11 @@ static void tlbimvaa_is_write(CPUARMState *env, const ARMCPRegInfo *ri,
 {
     CPUState *cs = env_cpu(env);
 
-    tlb_flush_page_all_cpus_synced(cs, value & TARGET_PAGE_MASK);
+    tlb_flush_range_by_mmuidx_all_cpus_batched(cs, value & TARGET_PAGE_MASK,
+                                               TARGET_PAGE_SIZE,
+                                               (1 << NB_MMU_MODES) - 1,
+                                               TARGET_LONG_BITS);
+    env->tlbi_batch.bcast = 1;
 }
 
 /*
@@ -537,6 +635,96 @@ static void tlbimvaa_write(CPUARMState *env, const ARMCPRegInfo *ri,
     }
 }
 
+/*
+ * Guests invalidate a range of VAs by issuing one TLBIMVA per page, and
+ * each of those used to be a separate tlb_flush_page(). Instead, the
+ * translator routes ARM_CP_TLBI_BATCH writes here and adjacent pages
+ * are merged into a single pending range. TLB maintenance is only
+ * guaranteed to have completed after a DSB, so the range is flushed with
+ * one tlb_flush_range_by_mmuidx() call from DSB, ISB and exception entry,
+ * or when a page that does not extend it comes along.
+ */
+static void arm_tlbi_batch_flush_local(CPUARMState *env)
+{
+    if (env->tlbi_batch.len) {
+        tlb_flush_range_by_mmuidx(env_cpu(env), env->tlbi_batch.addr,
+                                  env->tlbi_batch.len,
+                                  (1 << NB_MMU_MODES) - 1, TARGET_LONG_BITS);
+        env->tlbi_batch.len = 0;
+    }
+}
+
+bool arm_tlbi_batch_flush(CPUARMState *env)
+{
+    arm_tlbi_batch_flush_local(env);
+    if (env->tlbi_batch.bcast) {
+        env->tlbi_batch.bcast = 0;
+        return tlb_flush_batch_sync(env_cpu(env));
+    }
+    return false;
+}
+
+void HELPER(tlbi_batch_page)(CPUARMState *env, uint32_t value)
+{
+    uint32_t page = value & TARGET_PAGE_MASK;
+    uint32_t addr = env->tlbi_batch.addr;
+    uint32_t len = env->tlbi_batch.len;
+
+    /*
+     * Only the local range is flushed here: the IS invalidations stay
+     * pending until the barrier, which leaves the TB to complete them.
+     */
+    if (tlb_force_broadcast(env)) {
+        arm_tlbi_batch_flush_local(env);
+        tlb_flush_page_all_cpus_synced(env_cpu(env), page);
+        return;
+    }
+
+    if (len) {
+        if (page >= addr && page - addr < len) {
+            /* Already covered */
+            return;
+        }
+        if (page >= addr && page - addr == len) {
+            env->tlbi_batch.len += TARGET_PAGE_SIZE;
+            return;
+        }
+        if (page == addr - TARGET_PAGE_SIZE) {
+            env->tlbi_batch.addr = page;
+            env->tlbi_batch.len += TARGET_PAGE_SIZE;
+            return;
+        }
+        arm_tlbi_batch_flush_local(env);
+    }
+    env->tlbi_batch.addr = page;
+    env->tlbi_batch.len = TARGET_PAGE_SIZE;
+}
+
+void HELPER(tlbi_batch_flush)(CPUARMState *env)
+{
+    if (arm_tlbi_batch_flush(env)) {
+        /*
+         * The IS flushes are only complete once this vCPU has left the
+         * TB. Do so now and execute the barrier again, which then finds
+         * nothing pending.
+         */
+        cpu_loop_exit_restore(env_cpu(env), GETPC());
+    }
+}
+
+static void cp15_dsb_write(CPUARMState *env, const ARMCPRegInfo *ri,
+                           uint64_t value)
+{
+    /* Legacy CP15DSB completes outstanding TLB maintenance too */
+    arm_tlbi_batch_flush(env);
+}
+
+static void cp15_isb_write(CPUARMState *env, const ARMCPRegInfo *ri,
+                           uint64_t value)
+{
+    arm_tlbi_batch_flush(env);
+}
+
 static void tlbiall_nsnh_write(CPUARMState *env, const ARMCPRegInfo *ri,
                                uint64_t value)
 {
@@ -724,13 +912,13 @@ static const ARMCPRegInfo not_v7_cp_reginfo[] = {
       .type = ARM_CP_NO_RAW },
     { .name = "TLBIMVA", .cp = 15, .crn = 8, .crm = CP_ANY,
       .opc1 = CP_ANY, .opc2 = 1, .access = PL1_W, .writefn = tlbimva_write,
-      .type = ARM_CP_NO_RAW },
+      .type = ARM_CP_NO_RAW | ARM_CP_TLBI_BATCH },
     { .name = "TLBIASID", .cp = 15, .crn = 8, .crm = CP_ANY,
       .opc1 = CP_ANY, .opc2 = 2, .access = PL1_W, .writefn = tlbiasid_write,
       .type = ARM_CP_NO_RAW },
     { .name = "TLBIMVAA", .cp = 15, .crn = 8, .crm = CP_ANY,
       .opc1 = CP_ANY, .opc2 = 3, .access = PL1_W, .writefn = tlbimvaa_write,
-      .type = ARM_CP_NO_RAW },
+      .type = ARM_CP_NO_RAW | ARM_CP_TLBI_BATCH },
     { .name = "PRRR", .cp = 15, .crn = 10, .crm = 2,
       .opc1 = 0, .opc2 = 0, .access = PL1_RW, .type = ARM_CP_NOP },
     { .name = "NMRR", .cp = 15, .crn = 10, .crm = 2,
@@ -849,12 +1037,14 @@ static const ARMCPRegInfo v6_cp_reginfo[] = {
     /*
      * We need to break the TB after ISB to execute self-modifying code
      * correctly and also to take any pending interrupts immediately.
-     * So use arm_cp_write_ignore() function instead of ARM_CP_NOP flag.
+     * So use a writefn instead of ARM_CP_NOP flag; both barriers also
+     * complete any batched TLB maintenance.  DSB ends the TB as well,
+     * since batched IS invalidations only complete once we leave it.
      */
     { .name = "ISB", .cp = 15, .crn = 7, .crm = 5, .opc1 = 0, .opc2 = 4,
-      .access = PL0_W, .type = ARM_CP_NO_RAW, .writefn = arm_cp_write_ignore },
+      .access = PL0_W, .type = ARM_CP_NO_RAW, .writefn = cp15_isb_write },
     { .name = "DSB", .cp = 15, .crn = 7, .crm = 10, .opc1 = 0, .opc2 = 4,
-      .access = PL0_W, .type = ARM_CP_NOP },
+      .access = PL0_W, .type = ARM_CP_NO_RAW, .writefn = cp15_dsb_write },
     { .name = "DMB", .cp = 15, .crn = 7, .crm = 10, .opc1 = 0, .opc2 = 5,
       .access = PL0_W, .type = ARM_CP_NOP },
     { .name = "IFAR", .cp = 15, .crn = 6, .crm = 0, .opc1 = 0, .opc2 = 2,
@@ -2292,29 +2482,33 @@ static const ARMCPRegInfo v7_cp_reginfo[] = {
       .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlb,
       .writefn = tlbiall_write },
     { .name = "TLBIMVA", .cp = 15, .opc1 = 0, .crn = 8, .crm = 7, .opc2 = 1,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlb,
-      .writefn = tlbimva_write },
+      .type = ARM_CP_NO_RAW | ARM_CP_TLBI_BATCH, .access = PL1_W,
+      .accessfn = access_ttlb, .writefn = tlbimva_write },
     { .name = "TLBIASID", .cp = 15, .opc1 = 0, .crn = 8, .crm = 7, .opc2 = 2,
       .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlb,
       .writefn = tlbiasid_write },
     { .name = "TLBIMVAA", .cp = 15, .opc1 = 0, .crn = 8, .crm = 7, .opc2 = 3,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlb,
-      .writefn = tlbimvaa_write },
+      .type = ARM_CP_NO_RAW | ARM_CP_TLBI_BATCH, .access = PL1_W,
+      .accessfn = access_ttlb, .writefn = tlbimvaa_write },
 };
 
 static const ARMCPRegInfo v7mp_cp_reginfo[] = {
     /* 32 bit TLB invalidates, Inner Shareable */
     { .name = "TLBIALLIS", .cp = 15, .opc1 = 0, .crn = 8, .crm = 3, .opc2 = 0,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlbis,
+      .type = ARM_CP_NO_RAW | ARM_CP_SUPPRESS_TB_END, .access = PL1_W,
+      .accessfn = access_ttlbis,
       .writefn = tlbiall_is_write },
     { .name = "TLBIMVAIS", .cp = 15, .opc1 = 0, .crn = 8, .crm = 3, .opc2 = 1,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlbis,
+      .type = ARM_CP_NO_RAW | ARM_CP_SUPPRESS_TB_END, .access = PL1_W,
+      .accessfn = access_ttlbis,
       .writefn = tlbimva_is_write },
     { .name = "TLBIASIDIS", .cp = 15, .opc1 = 0, .crn = 8, .crm = 3, .opc2 = 2,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlbis,
+      .type = ARM_CP_NO_RAW | ARM_CP_SUPPRESS_TB_END, .access = PL1_W,
+      .accessfn = access_ttlbis,
       .writefn = tlbiasid_is_write },
     { .name = "TLBIMVAAIS", .cp = 15, .opc1 = 0, .crn = 8, .crm = 3, .opc2 = 3,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlbis,
+      .type = ARM_CP_NO_RAW | ARM_CP_SUPPRESS_TB_END, .access = PL1_W,
+      .accessfn = access_ttlbis,
       .writefn = tlbimvaa_is_write },
 };
 
@@ -5603,10 +5797,12 @@ static const ARMCPRegInfo v8_cp_reginfo[] = {
 #endif
     /* TLB invalidate last level of translation table walk */
     { .name = "TLBIMVALIS", .cp = 15, .opc1 = 0, .crn = 8, .crm = 3, .opc2 = 5,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlbis,
+      .type = ARM_CP_NO_RAW | ARM_CP_SUPPRESS_TB_END, .access = PL1_W,
+      .accessfn = access_ttlbis,
       .writefn = tlbimva_is_write },
     { .name = "TLBIMVAALIS", .cp = 15, .opc1 = 0, .crn = 8, .crm = 3, .opc2 = 7,
-      .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlbis,
+      .type = ARM_CP_NO_RAW | ARM_CP_SUPPRESS_TB_END, .access = PL1_W,
+      .accessfn = access_ttlbis,
       .writefn = tlbimvaa_is_write },
     { .name = "TLBIMVAL", .cp = 15, .opc1 = 0, .crn = 8, .crm = 7, .opc2 = 5,
       .type = ARM_CP_NO_RAW, .access = PL1_W, .accessfn = access_ttlb,
@@ -5639,31 +5835,41 @@ static const ARMCPRegInfo v8_cp_reginfo[] = {
       .writefn = tlbiipas2is_hyp_write },
     /* 32 bit cache operations */
     { .name = "ICIALLUIS", .cp = 15, .opc1 = 0, .crn = 7, .crm = 1, .opc2 = 0,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_ticab },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_ticab },
     { .name = "BPIALLUIS", .cp = 15, .opc1 = 0, .crn = 7, .crm = 1, .opc2 = 6,
       .type = ARM_CP_NOP, .access = PL1_W },
     { .name = "ICIALLU", .cp = 15, .opc1 = 0, .crn = 7, .crm = 5, .opc2 = 0,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_tocu },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_tocu },
     { .name = "ICIMVAU", .cp = 15, .opc1 = 0, .crn = 7, .crm = 5, .opc2 = 1,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_tocu },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_tocu },
     { .name = "BPIALL", .cp = 15, .opc1 = 0, .crn = 7, .crm = 5, .opc2 = 6,
       .type = ARM_CP_NOP, .access = PL1_W },
     { .name = "BPIMVA", .cp = 15, .opc1 = 0, .crn = 7, .crm = 5, .opc2 = 7,
       .type = ARM_CP_NOP, .access = PL1_W },
     { .name = "DCIMVAC", .cp = 15, .opc1 = 0, .crn = 7, .crm = 6, .opc2 = 1,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = aa64_cacheop_poc_access },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = aa64_cacheop_poc_access },
     { .name = "DCISW", .cp = 15, .opc1 = 0, .crn = 7, .crm = 6, .opc2 = 2,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_tsw },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_tsw },
     { .name = "DCCMVAC", .cp = 15, .opc1 = 0, .crn = 7, .crm = 10, .opc2 = 1,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = aa64_cacheop_poc_access },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = aa64_cacheop_poc_access },
     { .name = "DCCSW", .cp = 15, .opc1 = 0, .crn = 7, .crm = 10, .opc2 = 2,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_tsw },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_tsw },
     { .name = "DCCMVAU", .cp = 15, .opc1 = 0, .crn = 7, .crm = 11, .opc2 = 1,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_tocu },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_tocu },
     { .name = "DCCIMVAC", .cp = 15, .opc1 = 0, .crn = 7, .crm = 14, .opc2 = 1,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = aa64_cacheop_poc_access },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = aa64_cacheop_poc_access },
     { .name = "DCCISW", .cp = 15, .opc1 = 0, .crn = 7, .crm = 14, .opc2 = 2,
-      .type = ARM_CP_NOP, .access = PL1_W, .accessfn = access_tsw },
+      .type = ARM_CP_NOP | ARM_CP_CACHE_MAINT, .access = PL1_W,
+      .accessfn = access_tsw },
     /* MMU Domain access control / MPU write buffer control */
     { .name = "DACR", .cp = 15, .opc1 = 0, .crn = 3, .crm = 0, .opc2 = 0,
       .access = PL1_RW, .accessfn = access_tvm_trvm, .resetvalue = 0,
@@ -9682,6 +9888,9 @@ static void add_cpreg_to_hashtable(ARMCPU *cpu, const ARMCPRegInfo *r,
     }
 
     g_hash_table_insert(cpu->cp_regs, (gpointer)(uintptr_t)key, r2);
+    if (cpu->cp15_table) {
+        arm_cp15_table_insert(cpu->cp15_table, key, r2);
+    }
 }
 
 
@@ -11311,6 +11520,9 @@ void arm_cpu_do_interrupt(CPUState *cs)
 
     assert(!arm_feature(env, ARM_FEATURE_M));
 
+    /* Exception entry is a context synchronization event */
+    arm_tlbi_batch_flush(env);
+
     arm_log_exception(cs);
     qemu_log_mask(CPU_LOG_INT, "...from EL%d to EL%d\n", arm_current_el(env),
                   new_el);
@@ -188,6 +188,17 @@ void aarch64_cpu_register(const ARMCPUInfo *info);
 
 void register_cp_regs_for_features(ARMCPU *cpu);
 void init_cpreg_list(ARMCPU *cpu);
+void init_cp15_table(ARMCPU *cpu);
+
+/**
+ * arm_tlbi_batch_flush:
+ * @env: CPUARMState
+ *
+ * Complete any TLB invalidation batched up by HELPER(tlbi_batch_page)
+ * or by the IS invalidations.  Returns true if the latter were issued,
+ * in which case they are only complete once the vCPU has left the TB.
+ */
+bool arm_tlbi_batch_flush(CPUARMState *env);
 
 void arm_cpu_register_gdb_regs_for_features(ARMCPU *cpu);
 void arm_translate_init(void);
@@ -3,6 +3,7 @@
 #include "qemu/error-report.h"
 #include "sysemu/kvm.h"
 #include "sysemu/tcg.h"
+#include "exec/exec-all.h"
 #include "kvm_arm.h"
 #include "internals.h"
 #include "cpu-features.h"
@@ -853,6 +854,8 @@ static int cpu_post_load(void *opaque, int version_id)
     if (tcg_enabled()) {
         hw_breakpoint_update_all(cpu);
         hw_watchpoint_update_all(cpu);
+        /* CONTEXTIDR was synced without going through its writefn */
+        tlb_reset_asid(CPU(cpu));
     }
 
     /*
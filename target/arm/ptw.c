@@ -619,6 +619,82 @@ static bool S1_ptw_translate(CPUARMState *env, S1Translate *ptw,
     return false;
 }
 
+/*
+ * Page-table walk cache.
+ *
+ * Valid table descriptors (short-descriptor level 1 page table entries
+ * and LPAE table entries) are remembered by the physical address and
+ * security space they were read from, and nothing else. The architecture
+ * permits caching such entries until TLB maintenance, and a guest that
+ * edits a table descriptor must follow up with a TLBI, which flushes
+ * this CPU's softmmu TLB. The whole cache is dropped whenever the TLB
+ * flush generation moves, which includes every ASID switch, since the
+ * entries are not tagged with the ASID or TTBR they were walked for.
+ *
+ * Only stage 1 (or stage 2) walks whose descriptor loads go straight to
+ * physical memory use the cache, and never debug accesses, which may
+ * come from another thread.
+ */
+static bool ptw_cache_usable(CPUARMState *env, S1Translate *ptw)
+{
+    return !ptw->in_debug &&
+           ptw->in_ptw_idx >= ARMMMUIdx_Phys_S &&
+           ptw->in_ptw_idx <= ARMMMUIdx_Phys_Realm &&
+           !cpu_isar_feature(aa64_rme, env_archcpu(env));
+}
+
+static uint64_t ptw_cache_key(S1Translate *ptw, hwaddr addr)
+{
+    return addr << 3 | (ptw->in_ptw_idx - ARMMMUIdx_Phys_S) << 1 | 1;
+}
+
+static ARMWalkCache *ptw_cache(CPUARMState *env)
+{
+    ARMWalkCache *wc = &env_archcpu(env)->walk_cache;
+    size_t gen = tlb_flush_generation(env_cpu(env));
+
+    if (wc->tlb_gen != gen) {
+        memset(wc->entries, 0, sizeof(wc->entries));
+        wc->tlb_gen = gen;
+    }
+    return wc;
+}
+
+static bool ptw_cache_lookup(CPUARMState *env, S1Translate *ptw,
+                             hwaddr addr, uint64_t *desc)
+{
+    ARMWalkCache *wc;
+    unsigned i;
+
+    if (!ptw_cache_usable(env, ptw)) {
+        return false;
+    }
+    wc = ptw_cache(env);
+    i = (addr >> 2) & (ARM_WALK_CACHE_SIZE - 1);
+    if (wc->entries[i].key == ptw_cache_key(ptw, addr)) {
+        wc->hits++;
+        *desc = wc->entries[i].desc;
+        return true;
+    }
+    wc->misses++;
+    return false;
+}
+
+static void ptw_cache_insert(CPUARMState *env, S1Translate *ptw,
+                             hwaddr addr, uint64_t desc)
+{
+    ARMWalkCache *wc;
+    unsigned i;
+
+    if (!ptw_cache_usable(env, ptw)) {
+        return;
+    }
+    wc = ptw_cache(env);
+    i = (addr >> 2) & (ARM_WALK_CACHE_SIZE - 1);
+    wc->entries[i].key = ptw_cache_key(ptw, addr);
+    wc->entries[i].desc = desc;
+}
+
 /* All loads done in the course of a page table walk go through here. */
 static uint32_t arm_ldl_ptw(CPUARMState *env, S1Translate *ptw,
                             ARMMMUFaultInfo *fi)
@@ -1053,6 +1129,7 @@ static bool get_phys_addr_v6(CPUARMState *env, S1Translate *ptw,
     int level = 1;
     uint32_t table;
     uint32_t desc;
+    uint64_t cached;
     uint32_t xn;
     uint32_t pxn = 0;
     int type;
@@ -1064,6 +1141,10 @@ static bool get_phys_addr_v6(CPUARMState *env, S1Translate *ptw,
     bool ns;
     int user_prot;
 
+    if (!ptw->in_debug) {
+        cpu->walk_cache.walks++;
+    }
+
     /* Pagetable walk.  */
     /* Lookup l1 descriptor.  */
     if (!get_level1_table_address(env, mmu_idx, &table, address)) {
@@ -1071,12 +1152,19 @@ static bool get_phys_addr_v6(CPUARMState *env, S1Translate *ptw,
         fi->type = ARMFault_Translation;
         goto do_fault;
     }
-    if (!S1_ptw_translate(env, ptw, table, fi)) {
-        goto do_fault;
-    }
-    desc = arm_ldl_ptw(env, ptw, fi);
-    if (fi->type != ARMFault_None) {
-        goto do_fault;
+    if (ptw_cache_lookup(env, ptw, table, &cached)) {
+        desc = cached;
+    } else {
+        if (!S1_ptw_translate(env, ptw, table, fi)) {
+            goto do_fault;
+        }
+        desc = arm_ldl_ptw(env, ptw, fi);
+        if (fi->type != ARMFault_None) {
+            goto do_fault;
+        }
+        if ((desc & 3) == 1) {
+            ptw_cache_insert(env, ptw, table, desc);
+        }
     }
     type = (desc & 3);
     if (type == 0 || (type == 3 && !cpu_isar_feature(aa32_pxn, cpu))) {
@@ -1621,6 +1709,10 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
     uint64_t descriptor, new_descriptor;
     ARMSecuritySpace out_space;
 
+    if (!ptw->in_debug) {
+        cpu->walk_cache.walks++;
+    }
+
     /* TODO: This code does not support shareability levels. */
     if (aarch64) {
         int ps;
@@ -1806,12 +1898,17 @@ static bool get_phys_addr_lpae(CPUARMState *env, S1Translate *ptw,
         ptw->in_space = ARMSS_NonSecure;
     }
 
-    if (!S1_ptw_translate(env, ptw, descaddr, fi)) {
-        goto do_fault;
-    }
-    descriptor = arm_ldq_ptw(env, ptw, fi);
-    if (fi->type != ARMFault_None) {
-        goto do_fault;
+    if (level == 3 || !ptw_cache_lookup(env, ptw, descaddr, &descriptor)) {
+        if (!S1_ptw_translate(env, ptw, descaddr, fi)) {
+            goto do_fault;
+        }
+        descriptor = arm_ldq_ptw(env, ptw, fi);
+        if (fi->type != ARMFault_None) {
+            goto do_fault;
+        }
+        if (level < 3 && (descriptor & 3) == 3) {
+            ptw_cache_insert(env, ptw, descaddr, descriptor);
+        }
     }
     new_descriptor = descriptor;
 
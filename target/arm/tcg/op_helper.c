@@ -25,6 +25,7 @@
 #include "exec/exec-all.h"
 #include "exec/cpu_ldst.h"
 #include "cpregs.h"
+#include "trace/trace-target_arm.h"
 
 #define SIGNBIT (uint32_t)0x80000000
 #define SIGNBIT64 ((uint64_t)1 << 63)
@@ -241,6 +242,15 @@ void HELPER(setend)(CPUARMState *env)
     arm_rebuild_hflags(env);
 }
 
+/*
+ * Called on the failure path of STREX when the arm_strex_contention trace
+ * event was enabled at translation time.
+ */
+void HELPER(strex_contention)(CPUARMState *env, uint32_t pc)
+{
+    trace_arm_strex_contention(env_cpu(env)->cpu_index, pc);
+}
+
 void HELPER(check_bxj_trap)(CPUARMState *env, uint32_t rm)
 {
     /*
@@ -629,7 +639,8 @@ const void *HELPER(access_check_cp_reg)(CPUARMState *env, uint32_t key,
                                         uint32_t syndrome, uint32_t isread)
 {
     ARMCPU *cpu = env_archcpu(env);
-    const ARMCPRegInfo *ri = get_arm_cp_reginfo(cpu->cp_regs, key);
+    const ARMCPRegInfo *ri = get_arm_cp_reginfo_fast(cpu->cp_regs,
+                                                     cpu->cp15_table, key);
     CPAccessResult res = CP_ACCESS_OK;
     int target_el;
 
@@ -759,7 +770,8 @@ const void *HELPER(access_check_cp_reg)(CPUARMState *env, uint32_t key,
 const void *HELPER(lookup_cp_reg)(CPUARMState *env, uint32_t key)
 {
     ARMCPU *cpu = env_archcpu(env);
-    const ARMCPRegInfo *ri = get_arm_cp_reginfo(cpu->cp_regs, key);
+    const ARMCPRegInfo *ri = get_arm_cp_reginfo_fast(cpu->cp_regs,
+                                                     cpu->cp15_table, key);
 
     assert(ri != NULL);
     return ri;
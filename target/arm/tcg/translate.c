@@ -28,6 +28,7 @@
 #include "semihosting/semihost.h"
 #include "cpregs.h"
 #include "exec/helper-proto.h"
+#include "trace/trace-target_arm.h"
 
 #define HELPER_H "helper.h"
 #include "exec/helper-info.c.inc"
@@ -315,6 +316,12 @@ void store_reg(DisasContext *s, int reg, TCGv_i32 var)
         /* For M-profile SP bits [1:0] are always zero */
         tcg_gen_andi_i32(var, var, ~3);
     }
+    if (s->pred_cond != TCG_COND_ALWAYS) {
+        /* Predicated insn in an IT block, see gen_it_predicate() */
+        tcg_gen_movcond_i32(s->pred_cond, cpu_R[reg], s->it_cc,
+                            tcg_constant_i32(0), var, cpu_R[reg]);
+        return;
+    }
     tcg_gen_mov_i32(cpu_R[reg], var);
 }
 
@@ -755,6 +762,8 @@ void gen_update_pc(DisasContext *s, target_long diff)
 static inline void gen_bx(DisasContext *s, TCGv_i32 var)
 {
     s->base.is_jmp = DISAS_JUMP;
+    s->bx_key = tcg_temp_new_i32();
+    tcg_gen_mov_i32(s->bx_key, var);
     tcg_gen_andi_i32(cpu_R[15], var, ~1);
     tcg_gen_andi_i32(var, var, 1);
     store_cpu_field(var, thumb);
@@ -2528,6 +2537,20 @@ static void gen_goto_ptr(void)
     tcg_gen_lookup_and_goto_ptr();
 }
 
+/* End the TB after gen_bx(), trying the last target of the branch first. */
+static void gen_goto_ptr_bx(DisasContext *s)
+{
+    TCGv_i64 key;
+
+    if (!s->bx_key) {
+        gen_goto_ptr();
+        return;
+    }
+    key = tcg_temp_new_i64();
+    tcg_gen_extu_i32_i64(key, s->bx_key);
+    translator_goto_ptr_cached(&s->base, key, s->bx_return);
+}
+
 /* This will end the TB but doesn't guarantee we'll return to
  * cpu_loop_exec. Any live exit_requests will be processed as we
  * enter the next TB.
@@ -2607,6 +2630,41 @@ static inline void gen_jmp(DisasContext *s, target_long diff)
     gen_jmp_tb(s, diff, 0);
 }
 
+/*
+ * Direct branch which a CF_TRACE TB may continue through, on either
+ * the taken or the condition-failed path, instead of ending the TB.
+ */
+static void gen_jmp_or_follow(DisasContext *s, target_long diff)
+{
+    target_ulong dest = s->pc_curr + diff;
+
+    if (s->ss_active || s->base.is_jmp != DISAS_NEXT || s->condexec_mask) {
+        gen_jmp(s, diff);
+        return;
+    }
+
+    if (translator_trace_follow(&s->base, dest)) {
+        if (s->condjmp) {
+            /* Leave by the condition-failed path at the end of the TB. */
+            int n = s->num_trace_exits++;
+
+            s->trace_exit[n].label = s->condlabel;
+            s->trace_exit[n].pc = s->base.pc_next;
+            s->condjmp = 0;
+        }
+        s->base.pc_next = dest;
+    } else if (s->condjmp && translator_trace_follow(&s->base,
+                                                     s->base.pc_next)) {
+        /* goto_tb slots are kept for the end of the TB. */
+        gen_update_pc(s, diff);
+        gen_goto_ptr();
+        set_disas_label(s, s->condlabel);
+        s->condjmp = 0;
+    } else {
+        gen_jmp(s, diff);
+    }
+}
+
 static inline void gen_mulxy(TCGv_i32 t0, TCGv_i32 t1, int x, int y)
 {
     if (x)
@@ -2943,6 +3001,26 @@ void gen_gvec_sqrdmlsh_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
     gen_gvec_fn3_qc(rd_ofs, rn_ofs, rm_ofs, opr_sz, max_sz, fns[vece - 1]);
 }
 
+void gen_gvec_sqdmulh_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                         uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz)
+{
+    static gen_helper_gvec_3_ptr * const fns[2] = {
+        gen_helper_neon_sqdmulh_h, gen_helper_neon_sqdmulh_s
+    };
+    tcg_debug_assert(vece >= 1 && vece <= 2);
+    gen_gvec_fn3_qc(rd_ofs, rn_ofs, rm_ofs, opr_sz, max_sz, fns[vece - 1]);
+}
+
+void gen_gvec_sqrdmulh_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                          uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz)
+{
+    static gen_helper_gvec_3_ptr * const fns[2] = {
+        gen_helper_neon_sqrdmulh_h, gen_helper_neon_sqrdmulh_s
+    };
+    tcg_debug_assert(vece >= 1 && vece <= 2);
+    gen_gvec_fn3_qc(rd_ofs, rn_ofs, rm_ofs, opr_sz, max_sz, fns[vece - 1]);
+}
+
 #define GEN_CMP0(NAME, COND)                              \
     void NAME(unsigned vece, uint32_t d, uint32_t m,      \
               uint32_t opr_sz, uint32_t max_sz)           \
@@ -2956,6 +3034,258 @@ GEN_CMP0(gen_gvec_cgt0, TCG_COND_GT)
 
 #undef GEN_CMP0
 
+/*
+ * Pairwise add long: each element of twice the input size is the sum of
+ * the two adjacent input elements it overlaps, sign or zero extended.
+ * The gen_gvec_*addlp and *adalp expanders take the input element size.
+ */
+static void gen_saddlp_h_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    tcg_gen_vec_shl16i_i64(t, n, 8);
+    tcg_gen_vec_sar16i_i64(d, n, 8);
+    tcg_gen_vec_sar16i_i64(t, t, 8);
+    tcg_gen_vec_add16_i64(d, d, t);
+}
+
+static void gen_saddlp_s_i32(TCGv_i32 d, TCGv_i32 n)
+{
+    TCGv_i32 t = tcg_temp_new_i32();
+
+    tcg_gen_ext16s_i32(t, n);
+    tcg_gen_sari_i32(d, n, 16);
+    tcg_gen_add_i32(d, d, t);
+}
+
+static void gen_saddlp_d_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    tcg_gen_ext32s_i64(t, n);
+    tcg_gen_sari_i64(d, n, 32);
+    tcg_gen_add_i64(d, d, t);
+}
+
+static void gen_saddlp_vec(unsigned vece, TCGv_vec d, TCGv_vec n)
+{
+    int half = 4 << vece;
+    TCGv_vec t = tcg_temp_new_vec_matching(d);
+
+    tcg_gen_shli_vec(vece, t, n, half);
+    tcg_gen_sari_vec(vece, d, n, half);
+    tcg_gen_sari_vec(vece, t, t, half);
+    tcg_gen_add_vec(vece, d, d, t);
+}
+
+static void gen_uaddlp_h_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    tcg_gen_vec_shr16i_i64(t, n, 8);
+    tcg_gen_andi_i64(d, n, dup_const(MO_16, 0xff));
+    tcg_gen_vec_add16_i64(d, d, t);
+}
+
+static void gen_uaddlp_s_i32(TCGv_i32 d, TCGv_i32 n)
+{
+    TCGv_i32 t = tcg_temp_new_i32();
+
+    tcg_gen_ext16u_i32(t, n);
+    tcg_gen_shri_i32(d, n, 16);
+    tcg_gen_add_i32(d, d, t);
+}
+
+static void gen_uaddlp_d_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    tcg_gen_ext32u_i64(t, n);
+    tcg_gen_shri_i64(d, n, 32);
+    tcg_gen_add_i64(d, d, t);
+}
+
+static void gen_uaddlp_vec(unsigned vece, TCGv_vec d, TCGv_vec n)
+{
+    int half = 4 << vece;
+    TCGv_vec t = tcg_temp_new_vec_matching(d);
+    TCGv_vec m = tcg_constant_vec_matching(d, vece, MAKE_64BIT_MASK(0, half));
+
+    tcg_gen_shri_vec(vece, t, n, half);
+    tcg_gen_and_vec(vece, d, n, m);
+    tcg_gen_add_vec(vece, d, d, t);
+}
+
+void gen_gvec_saddlp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz)
+{
+    static const TCGOpcode vecop_list[] = {
+        INDEX_op_shli_vec, INDEX_op_sari_vec, INDEX_op_add_vec, 0
+    };
+    static const GVecGen2 g[] = {
+        { .fni8 = gen_saddlp_h_i64,
+          .fniv = gen_saddlp_vec,
+          .opt_opc = vecop_list,
+          .vece = MO_16 },
+        { .fni4 = gen_saddlp_s_i32,
+          .fniv = gen_saddlp_vec,
+          .opt_opc = vecop_list,
+          .vece = MO_32 },
+        { .fni8 = gen_saddlp_d_i64,
+          .fniv = gen_saddlp_vec,
+          .prefer_i64 = TCG_TARGET_REG_BITS == 64,
+          .opt_opc = vecop_list,
+          .vece = MO_64 },
+    };
+    tcg_debug_assert(vece <= MO_32);
+    tcg_gen_gvec_2(rd_ofs, rn_ofs, opr_sz, max_sz, &g[vece]);
+}
+
+void gen_gvec_uaddlp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz)
+{
+    static const TCGOpcode vecop_list[] = {
+        INDEX_op_shri_vec, INDEX_op_add_vec, 0
+    };
+    static const GVecGen2 g[] = {
+        { .fni8 = gen_uaddlp_h_i64,
+          .fniv = gen_uaddlp_vec,
+          .opt_opc = vecop_list,
+          .vece = MO_16 },
+        { .fni4 = gen_uaddlp_s_i32,
+          .fniv = gen_uaddlp_vec,
+          .opt_opc = vecop_list,
+          .vece = MO_32 },
+        { .fni8 = gen_uaddlp_d_i64,
+          .fniv = gen_uaddlp_vec,
+          .prefer_i64 = TCG_TARGET_REG_BITS == 64,
+          .opt_opc = vecop_list,
+          .vece = MO_64 },
+    };
+    tcg_debug_assert(vece <= MO_32);
+    tcg_gen_gvec_2(rd_ofs, rn_ofs, opr_sz, max_sz, &g[vece]);
+}
+
+static void gen_sadalp_h_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    gen_saddlp_h_i64(t, n);
+    tcg_gen_vec_add16_i64(d, d, t);
+}
+
+static void gen_sadalp_s_i32(TCGv_i32 d, TCGv_i32 n)
+{
+    TCGv_i32 t = tcg_temp_new_i32();
+
+    gen_saddlp_s_i32(t, n);
+    tcg_gen_add_i32(d, d, t);
+}
+
+static void gen_sadalp_d_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    gen_saddlp_d_i64(t, n);
+    tcg_gen_add_i64(d, d, t);
+}
+
+static void gen_sadalp_vec(unsigned vece, TCGv_vec d, TCGv_vec n)
+{
+    TCGv_vec t = tcg_temp_new_vec_matching(d);
+
+    gen_saddlp_vec(vece, t, n);
+    tcg_gen_add_vec(vece, d, d, t);
+}
+
+static void gen_uadalp_h_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    gen_uaddlp_h_i64(t, n);
+    tcg_gen_vec_add16_i64(d, d, t);
+}
+
+static void gen_uadalp_s_i32(TCGv_i32 d, TCGv_i32 n)
+{
+    TCGv_i32 t = tcg_temp_new_i32();
+
+    gen_uaddlp_s_i32(t, n);
+    tcg_gen_add_i32(d, d, t);
+}
+
+static void gen_uadalp_d_i64(TCGv_i64 d, TCGv_i64 n)
+{
+    TCGv_i64 t = tcg_temp_new_i64();
+
+    gen_uaddlp_d_i64(t, n);
+    tcg_gen_add_i64(d, d, t);
+}
+
+static void gen_uadalp_vec(unsigned vece, TCGv_vec d, TCGv_vec n)
+{
+    TCGv_vec t = tcg_temp_new_vec_matching(d);
+
+    gen_uaddlp_vec(vece, t, n);
+    tcg_gen_add_vec(vece, d, d, t);
+}
+
+void gen_gvec_sadalp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz)
+{
+    static const TCGOpcode vecop_list[] = {
+        INDEX_op_shli_vec, INDEX_op_sari_vec, INDEX_op_add_vec, 0
+    };
+    static const GVecGen2 g[] = {
+        { .fni8 = gen_sadalp_h_i64,
+          .fniv = gen_sadalp_vec,
+          .load_dest = true,
+          .opt_opc = vecop_list,
+          .vece = MO_16 },
+        { .fni4 = gen_sadalp_s_i32,
+          .fniv = gen_sadalp_vec,
+          .load_dest = true,
+          .opt_opc = vecop_list,
+          .vece = MO_32 },
+        { .fni8 = gen_sadalp_d_i64,
+          .fniv = gen_sadalp_vec,
+          .prefer_i64 = TCG_TARGET_REG_BITS == 64,
+          .load_dest = true,
+          .opt_opc = vecop_list,
+          .vece = MO_64 },
+    };
+    tcg_debug_assert(vece <= MO_32);
+    tcg_gen_gvec_2(rd_ofs, rn_ofs, opr_sz, max_sz, &g[vece]);
+}
+
+void gen_gvec_uadalp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz)
+{
+    static const TCGOpcode vecop_list[] = {
+        INDEX_op_shri_vec, INDEX_op_add_vec, 0
+    };
+    static const GVecGen2 g[] = {
+        { .fni8 = gen_uadalp_h_i64,
+          .fniv = gen_uadalp_vec,
+          .load_dest = true,
+          .opt_opc = vecop_list,
+          .vece = MO_16 },
+        { .fni4 = gen_uadalp_s_i32,
+          .fniv = gen_uadalp_vec,
+          .load_dest = true,
+          .opt_opc = vecop_list,
+          .vece = MO_32 },
+        { .fni8 = gen_uadalp_d_i64,
+          .fniv = gen_uadalp_vec,
+          .prefer_i64 = TCG_TARGET_REG_BITS == 64,
+          .load_dest = true,
+          .opt_opc = vecop_list,
+          .vece = MO_64 },
+    };
+    tcg_debug_assert(vece <= MO_32);
+    tcg_gen_gvec_2(rd_ofs, rn_ofs, opr_sz, max_sz, &g[vece]);
+}
+
 static void gen_ssra8_i64(TCGv_i64 d, TCGv_i64 a, int64_t shift)
 {
     tcg_gen_vec_sar8i_i64(a, a, shift);
@@ -4514,12 +4844,48 @@ static bool aa32_cpreg_encoding_in_impdef_space(uint8_t crn, uint8_t crm)
     return false;
 }
 
+/*
+ * Return true if the accessfn of @ri cannot fail in this translation
+ * context, so the runtime access check can be left out.
+ */
+static bool cp_accessfn_always_ok(DisasContext *s, const ARMCPRegInfo *ri)
+{
+    /*
+     * Cache maintenance ops only trap from EL0 (SCTLR.UCI) or to EL2
+     * (HCR_EL2 bits), and with no EL2 the effective HCR_EL2 is zero.
+     */
+    return (ri->type & ARM_CP_CACHE_MAINT) && s->current_el >= 1 &&
+           !arm_dc_feature(s, ARM_FEATURE_EL2);
+}
+
+/*
+ * Complete any batched TLBIMVA range, see HELPER(tlbi_batch_page), and
+ * any batched IS invalidation.
+ * The inline test keeps barriers cheap when nothing is pending.
+ */
+static void gen_tlbi_batch_flush(DisasContext *s)
+{
+    TCGLabel *skip;
+    TCGv_i32 len;
+
+    if (arm_dc_feature(s, ARM_FEATURE_M)) {
+        return;
+    }
+    skip = gen_new_label();
+    len = load_cpu_field(tlbi_batch.len);
+    tcg_gen_or_i32(len, len, load_cpu_field(tlbi_batch.bcast));
+    tcg_gen_brcondi_i32(TCG_COND_EQ, len, 0, skip);
+    gen_helper_tlbi_batch_flush(tcg_env);
+    gen_set_label(skip);
+}
+
 static void do_coproc_insn(DisasContext *s, int cpnum, int is64,
                            int opc1, int crn, int crm, int opc2,
                            bool isread, int rt, int rt2)
 {
     uint32_t key = ENCODE_CP_REG(cpnum, is64, s->ns, crn, crm, opc1, opc2);
-    const ARMCPRegInfo *ri = get_arm_cp_reginfo(s->cp_regs, key);
+    const ARMCPRegInfo *ri = get_arm_cp_reginfo_fast(s->cp_regs,
+                                                     s->cp15_table, key);
     TCGv_ptr tcg_ri = NULL;
     bool need_exit_tb = false;
     uint32_t syndrome;
@@ -4642,7 +5008,8 @@ static void do_coproc_insn(DisasContext *s, int cpnum, int is64,
         return;
     }
 
-    if ((s->hstr_active && s->current_el == 0) || ri->accessfn ||
+    if ((s->hstr_active && s->current_el == 0) ||
+        (ri->accessfn && !cp_accessfn_always_ok(s, ri)) ||
         (ri->fgt && s->fgt_active) ||
         (arm_dc_feature(s, ARM_FEATURE_XSCALE) && cpnum < 14)) {
         /*
@@ -4758,7 +5125,10 @@ static void do_coproc_insn(DisasContext *s, int cpnum, int is64,
             }
         } else {
             TCGv_i32 tmp = load_reg(s, rt);
-            if (ri->writefn) {
+            if (ri->type & ARM_CP_TLBI_BATCH) {
+                /* Queue the page rather than flushing it right away */
+                gen_helper_tlbi_batch_page(tcg_env, tmp);
+            } else if (ri->writefn) {
                 if (!tcg_ri) {
                     tcg_ri = gen_lookup_cp_reg(key);
                 }
@@ -4769,7 +5139,14 @@ static void do_coproc_insn(DisasContext *s, int cpnum, int is64,
         }
     }
 
-    if (!isread && !(ri->type & ARM_CP_SUPPRESS_TB_END)) {
+    /*
+     * A batched TLBI changes no state the TB depends on. It only has to
+     * end the TB when HCR_EL2.FB may turn it into a broadcast, since the
+     * synced flush then waits for this vCPU to leave the TB.
+     */
+    if (!isread && !(ri->type & ARM_CP_SUPPRESS_TB_END) &&
+        !((ri->type & ARM_CP_TLBI_BATCH) &&
+          !arm_dc_feature(s, ARM_FEATURE_EL2))) {
         /*
          * A write to any coprocessor register that ends a TB
          * must rebuild the hflags for the next TB.
@@ -4953,6 +5330,325 @@ static void gen_store_exclusive(DisasContext *s, int rd, int rt, int rt2,
     tcg_gen_movi_i32(cpu_R[rd], 1);
     gen_set_label(done_label);
     tcg_gen_movi_i64(cpu_exclusive_addr, -1);
+
+    if (trace_event_get_state_backends(TRACE_ARM_STREX_CONTENTION)) {
+        TCGLabel *ok_label = gen_new_label();
+
+        tcg_gen_brcondi_i32(TCG_COND_EQ, cpu_R[rd], 0, ok_label);
+        gen_helper_strex_contention(tcg_env, tcg_constant_i32(s->pc_curr));
+        gen_set_label(ok_label);
+    }
+}
+
+/*
+ * Exclusive retry loops that compilers and hand-written atomics emit,
+ * in one of these shapes:
+ *
+ *   1: ldrex  rt, [rn]               1: ldrex  rt, [rn]
+ *      <op>   rt2, rt, #imm|rm          teq    rt, #0       (or cmp)
+ *      strex  rd, rt2, [rn]             strexeq rd, rm, [rn]
+ *      cmp    rd, #0   (or teq)         teqeq  rd, #0       (or cmp)
+ *      bne    1b                        bne    1b
+ *
+ * On the left <op> is AND, EOR, SUB, ADD, ORR or BIC, or is missing and
+ * the loop is a swap of rm. It is emitted as a single host atomic
+ * read-modify-write. The loop always exits with the store done, so Rd,
+ * the flags and the exclusive monitor are set to what a successful first
+ * pass leaves behind.
+ *
+ * On the right the loop waits for the word to be zero before storing rm
+ * (a test-and-set lock), and is emitted as a host cmpxchg against zero.
+ * If that finds the word non-zero, the state is that of the pass that
+ * loaded it, and execution continues at the LDREX in a new TB.
+ *
+ * A fault on the atomic is reported at the LDREX, which re-executes the
+ * whole loop once the guest has resolved it.
+ *
+ * Only done when every instruction in the sequence would otherwise have
+ * been translated into this TB with nothing observing the individual
+ * steps (icount, single-step, breakpoints in the page, plugins).
+ */
+
+/* Loops without a data processing op */
+#define EXCL_LOOP_SWAP      -1
+#define EXCL_LOOP_TAS       -2
+
+typedef enum ExclCheck {
+    EXCL_CHECK_CMP,         /* cmp rd, #0 */
+    EXCL_CHECK_TEQ,         /* teq rd, #0 */
+    EXCL_CHECK_CBNZ,        /* cbnz rd, which sets no flags */
+} ExclCheck;
+
+typedef struct ExclLoop {
+    int rn, rt, rt2, rm, rd;
+    /* A32 data processing opcode of <op>, or EXCL_LOOP_* */
+    int op;
+    bool is_imm;
+    uint32_t imm;
+    /* Test of rd after the STREX, and of rt before it for EXCL_LOOP_TAS */
+    ExclCheck check;
+    ExclCheck tas_check;
+    /* Length of the loop in bytes */
+    int len;
+} ExclLoop;
+
+static bool excl_loop_usable(DisasContext *s)
+{
+    return !(tb_cflags(s->base.tb) &
+             (CF_COUNT_MASK | CF_USE_ICOUNT | CF_SINGLE_STEP)) &&
+           !s->base.singlestep_enabled && !s->base.plugin_enabled &&
+           !s->ss_active && ENABLE_ARCH_6;
+}
+
+/*
+ * Check the registers of @l once it has been matched. @bad is a
+ * register that may not appear other than as the base, such as SP
+ * for T32, or -1.
+ */
+static bool excl_loop_regs_ok(const ExclLoop *l, int bad)
+{
+    if (l->rn == 15 || l->rt == 15 || l->rt == bad || l->rd == 15 ||
+        l->rd == bad || l->rt == l->rn || l->rd == l->rn) {
+        return false;
+    }
+    if (l->op >= 0 &&
+        (l->rt2 == 15 || l->rt2 == bad || l->rt2 == l->rn ||
+         l->rd == l->rt2)) {
+        return false;
+    }
+    if (!(l->op >= 0 && l->is_imm) &&
+        (l->rm == 15 || l->rm == bad || l->rm == l->rt || l->rd == l->rm)) {
+        return false;
+    }
+    /* Only the test-and-set loop leaves the same value, zero, in both */
+    return l->op == EXCL_LOOP_TAS || l->rd != l->rt;
+}
+
+/* Set the flags as @check leaves them when testing @val. */
+static void gen_excl_check_flags(ExclCheck check, TCGv_i32 val)
+{
+    if (check == EXCL_CHECK_CBNZ) {
+        return;
+    }
+    tcg_gen_mov_i32(cpu_NF, val);
+    tcg_gen_mov_i32(cpu_ZF, val);
+    if (check == EXCL_CHECK_CMP) {
+        tcg_gen_movi_i32(cpu_CF, 1);
+        tcg_gen_movi_i32(cpu_VF, 0);
+    }
+}
+
+static void gen_excl_loop(DisasContext *s, const ExclLoop *l)
+{
+    MemOp opc = MO_32 | MO_ALIGN | s->be_data;
+    int mem_idx = get_mem_index(s);
+    TCGv_i32 addr, val, oldv, newv;
+    TCGv taddr;
+
+    addr = load_reg(s, l->rn);
+    taddr = gen_aa32_addr(s, addr, opc);
+    val = l->op >= 0 && l->is_imm ? tcg_constant_i32(l->imm)
+                                  : load_reg(s, l->rm);
+    oldv = tcg_temp_new_i32();
+    newv = tcg_temp_new_i32();
+
+    switch (l->op) {
+    case EXCL_LOOP_SWAP:
+        tcg_gen_atomic_xchg_i32(oldv, taddr, val, mem_idx, opc);
+        break;
+    case EXCL_LOOP_TAS: {
+        TCGLabel *stored = gen_new_label();
+
+        tcg_gen_atomic_cmpxchg_i32(oldv, taddr, tcg_constant_i32(0), val,
+                                   mem_idx, opc);
+        tcg_gen_brcondi_i32(TCG_COND_EQ, oldv, 0, stored);
+
+        /* Taken: as left by the pass that loaded the word */
+        tcg_gen_mov_i32(cpu_R[l->rt], oldv);
+        gen_excl_check_flags(l->tas_check, oldv);
+        tcg_gen_extu_i32_i64(cpu_exclusive_addr, addr);
+        tcg_gen_extu_i32_i64(cpu_exclusive_val, oldv);
+        gen_pc_plus_diff(s, cpu_R[15], 0);
+        tcg_gen_lookup_and_goto_ptr();
+
+        gen_set_label(stored);
+        break;
+    }
+    case 0x0: /* AND */
+        tcg_gen_atomic_fetch_and_i32(oldv, taddr, val, mem_idx, opc);
+        tcg_gen_and_i32(newv, oldv, val);
+        break;
+    case 0x1: /* EOR */
+        tcg_gen_atomic_fetch_xor_i32(oldv, taddr, val, mem_idx, opc);
+        tcg_gen_xor_i32(newv, oldv, val);
+        break;
+    case 0x2: /* SUB */
+        tcg_gen_neg_i32(newv, val);
+        tcg_gen_atomic_fetch_add_i32(oldv, taddr, newv, mem_idx, opc);
+        tcg_gen_sub_i32(newv, oldv, val);
+        break;
+    case 0x4: /* ADD */
+        tcg_gen_atomic_fetch_add_i32(oldv, taddr, val, mem_idx, opc);
+        tcg_gen_add_i32(newv, oldv, val);
+        break;
+    case 0xc: /* ORR */
+        tcg_gen_atomic_fetch_or_i32(oldv, taddr, val, mem_idx, opc);
+        tcg_gen_or_i32(newv, oldv, val);
+        break;
+    case 0xe: /* BIC */
+        tcg_gen_not_i32(newv, val);
+        tcg_gen_atomic_fetch_and_i32(oldv, taddr, newv, mem_idx, opc);
+        tcg_gen_andc_i32(newv, oldv, val);
+        break;
+    default:
+        g_assert_not_reached();
+    }
+
+    store_reg(s, l->rt, oldv);
+    if (l->op >= 0) {
+        store_reg(s, l->rt2, newv);
+    }
+    tcg_gen_movi_i32(cpu_R[l->rd], 0);
+    gen_clrex(s);
+
+    /* Flags as left by the test of rd == 0 */
+    gen_excl_check_flags(l->check, tcg_constant_i32(0));
+
+    s->base.pc_next = s->pc_curr + l->len;
+}
+
+/*
+ * Return the ExclCheck of the A32 @insn testing @reg against zero
+ * under condition @cond, or -1.
+ */
+static int arm_excl_check(uint32_t insn, uint32_t cond, int reg)
+{
+    uint32_t test = cond << 28 | reg << 16;
+
+    if (insn == (test | 0x03500000)) {
+        return EXCL_CHECK_CMP;
+    }
+    if (insn == (test | 0x03300000)) {
+        return EXCL_CHECK_TEQ;
+    }
+    return -1;
+}
+
+/*
+ * Match an exclusive retry loop starting with the A32 LDREX @insn and
+ * emit it. Returns true if the loop was consumed.
+ */
+static bool arm_gen_excl_loop(DisasContext *s, CPUARMState *env,
+                              uint32_t insn)
+{
+    uint32_t pc = s->pc_curr;
+    ExclLoop l = { };
+    uint32_t next;
+    int n, check;
+
+    if (!excl_loop_usable(s)) {
+        return false;
+    }
+    /* ldrex rt, [rn], unconditional */
+    if ((insn & 0xfff00fff) != 0xe1900f9f) {
+        return false;
+    }
+    l.rn = extract32(insn, 16, 4);
+    l.rt = extract32(insn, 12, 4);
+
+    /* The whole loop must sit in the page we are already translating */
+    if (((pc + 16) ^ pc) & TARGET_PAGE_MASK) {
+        return false;
+    }
+
+    n = 1;
+    next = arm_ldl_code(env, &s->base, pc + 4, s->sctlr_b);
+    check = arm_excl_check(next, 0xe, l.rt);
+    if (check >= 0) {
+        /* Test-and-set: strexeq rd, rm, [rn] */
+        l.op = EXCL_LOOP_TAS;
+        l.tas_check = check;
+        n++;
+        next = arm_ldl_code(env, &s->base, pc + n * 4, s->sctlr_b);
+        if ((next & 0xfff00ff0) != 0x01800f90 ||
+            extract32(next, 16, 4) != l.rn) {
+            return false;
+        }
+        l.rd = extract32(next, 12, 4);
+        l.rm = extract32(next, 0, 4);
+        n++;
+        next = arm_ldl_code(env, &s->base, pc + n * 4, s->sctlr_b);
+        check = arm_excl_check(next, 0x0, l.rd);
+    } else {
+        l.op = EXCL_LOOP_SWAP;
+        l.rt2 = l.rt;
+        if ((next & 0xfc100000) == 0xe0000000) {
+            /* Unconditional data processing without S */
+            l.op = extract32(next, 21, 4);
+            switch (l.op) {
+            case 0x0: /* AND */
+            case 0x1: /* EOR */
+            case 0x2: /* SUB */
+            case 0x4: /* ADD */
+            case 0xc: /* ORR */
+            case 0xe: /* BIC */
+                break;
+            default:
+                return false;
+            }
+            if (extract32(next, 16, 4) != l.rt) {
+                return false;
+            }
+            l.rt2 = extract32(next, 12, 4);
+            if (next & (1 << 25)) {
+                l.is_imm = true;
+                l.imm = ror32(extract32(next, 0, 8),
+                              extract32(next, 8, 4) * 2);
+            } else if (extract32(next, 4, 8) != 0) {
+                /* Only a register operand without shift */
+                return false;
+            } else {
+                l.rm = extract32(next, 0, 4);
+            }
+            n++;
+            next = arm_ldl_code(env, &s->base, pc + n * 4, s->sctlr_b);
+        }
+
+        /* strex rd, rt2, [rn], unconditional */
+        if ((next & 0xfff00ff0) != 0xe1800f90 ||
+            extract32(next, 16, 4) != l.rn) {
+            return false;
+        }
+        l.rd = extract32(next, 12, 4);
+        if (l.op == EXCL_LOOP_SWAP) {
+            /* Swap: the stored register is the operand */
+            l.rm = extract32(next, 0, 4);
+        } else if (extract32(next, 0, 4) != l.rt2) {
+            return false;
+        }
+        n++;
+        next = arm_ldl_code(env, &s->base, pc + n * 4, s->sctlr_b);
+        check = arm_excl_check(next, 0xe, l.rd);
+    }
+    if (check < 0) {
+        return false;
+    }
+    l.check = check;
+    n++;
+
+    /* bne back to the ldrex */
+    next = arm_ldl_code(env, &s->base, pc + n * 4, s->sctlr_b);
+    if (next != (0x1a000000 | ((-(n + 2)) & 0xffffff))) {
+        return false;
+    }
+    n++;
+
+    if (!excl_loop_regs_ok(&l, -1)) {
+        return false;
+    }
+    l.len = n * 4;
+    gen_excl_loop(s, &l);
+    return true;
 }
 
 /* gen_srs:
@@ -5074,11 +5770,53 @@ static void gen_srs(DisasContext *s,
     s->base.is_jmp = DISAS_UPDATE_EXIT;
 }
 
+/*
+ * Return the comparison of cc_src1 against cc_src2 that is equivalent to
+ * condition @cc, or TCG_COND_NEVER if there is none or the operands of
+ * the last CMP/SUBS are not known.
+ */
+static TCGCond arm_cc_sub_cond(DisasContext *s, int cc)
+{
+    static const TCGCond sub_cond[16] = {
+        [0x0] = TCG_COND_EQ,
+        [0x1] = TCG_COND_NE,
+        [0x2] = TCG_COND_GEU,
+        [0x3] = TCG_COND_LTU,
+        [0x8] = TCG_COND_GTU,
+        [0x9] = TCG_COND_LEU,
+        [0xa] = TCG_COND_GE,
+        [0xb] = TCG_COND_LT,
+        [0xc] = TCG_COND_GT,
+        [0xd] = TCG_COND_LE,
+    };
+
+    return s->cc_sub ? sub_cond[cc & 0xf] : TCG_COND_NEVER;
+}
+
+/*
+ * Called at the start of each insn: the CMP/SUBS operands stay valid for
+ * one insn unless something extended them with cc_sub_keep.
+ */
+static void arm_advance_cc_sub(DisasContext *s)
+{
+    if (s->cc_sub_keep) {
+        s->cc_sub_keep = false;
+    } else {
+        s->cc_sub = false;
+    }
+}
+
 /* Skip this instruction if the ARM condition is false */
 static void arm_skip_unless(DisasContext *s, uint32_t cond)
 {
+    TCGCond c = arm_cc_sub_cond(s, cond ^ 1);
+
     arm_gen_condlabel(s);
-    arm_gen_test_cc(cond ^ 1, s->condlabel.label);
+    if (c != TCG_COND_NEVER) {
+        tcg_gen_brcond_i32(c, s->cc_src1, s->cc_src2, s->condlabel.label);
+    } else {
+        arm_gen_test_cc(cond ^ 1, s->condlabel.label);
+    }
 }
 
 
@@ -5281,6 +6019,27 @@ static bool store_reg_kind(DisasContext *s, int rd,
     g_assert_not_reached();
 }
 
+/*
+ * Remember the operands of an unconditional CMP/SUBS for the lazy
+ * condition code tests in arm_skip_unless() and gen_it_predicate().
+ * NZCV are still computed eagerly: anything that faults later in the TB
+ * needs them in env.
+ */
+static void gen_note_cc_sub(DisasContext *s,
+                            void (*gen)(TCGv_i32, TCGv_i32, TCGv_i32),
+                            TCGv_i32 t0, TCGv_i32 t1)
+{
+    if (gen != gen_sub_CC || s->condjmp) {
+        return;
+    }
+    s->cc_src1 = tcg_temp_new_i32();
+    s->cc_src2 = tcg_temp_new_i32();
+    tcg_gen_mov_i32(s->cc_src1, t0);
+    tcg_gen_mov_i32(s->cc_src2, t1);
+    s->cc_sub = true;
+    s->cc_sub_keep = true;
+}
+
 /*
  * Data Processing (register)
  *
@@ -5297,6 +6056,7 @@ static bool op_s_rrr_shi(DisasContext *s, arg_s_rrr_shi *a,
     gen_arm_shift_im(tmp2, a->shty, a->shim, logic_cc);
     tmp1 = load_reg(s, a->rn);
 
+    gen_note_cc_sub(s, gen, tmp1, tmp2);
     gen(tmp1, tmp1, tmp2);
 
     if (logic_cc) {
@@ -5338,6 +6098,7 @@ static bool op_s_rrr_shr(DisasContext *s, arg_s_rrr_shr *a,
     gen_arm_shift_reg(tmp2, a->shty, tmp1, logic_cc);
     tmp1 = load_reg(s, a->rn);
 
+    gen_note_cc_sub(s, gen, tmp1, tmp2);
     gen(tmp1, tmp1, tmp2);
 
     if (logic_cc) {
@@ -5386,6 +6147,7 @@ static bool op_s_rri_rot(DisasContext *s, arg_s_rri_rot *a,
     }
     tmp1 = load_reg(s, a->rn);
 
+    gen_note_cc_sub(s, gen, tmp1, tcg_constant_i32(imm));
     gen(tmp1, tmp1, tcg_constant_i32(imm));
 
     if (logic_cc) {
@@ -6283,6 +7045,7 @@ static bool trans_BX(DisasContext *s, arg_BX *a)
     if (!ENABLE_ARCH_4T) {
         return false;
     }
+    s->bx_return = a->rm == 14;
     gen_bx_excret(s, load_reg(s, a->rm));
     return true;
 }
@@ -6318,6 +7081,7 @@ static bool trans_BLX_r(DisasContext *s, arg_BLX_r *a)
     }
     tmp = load_reg(s, a->rm);
     gen_pc_plus_diff(s, cpu_R[14], curr_insn_len(s) | s->thumb);
+    translator_push_return(&s->base);
     gen_bx(s, tmp);
     return true;
 }
@@ -6560,6 +7324,7 @@ static bool op_load_rr(DisasContext *s, arg_ldst_rr *a,
      * ensure correct behavior with overlapping index registers.
      */
     op_addr_rr_post(s, a, addr, 0);
+    s->bx_return = a->rt == 15 && a->rn == 13;
     store_reg_from_load(s, a->rt, tmp);
     return true;
 }
@@ -6707,6 +7472,7 @@ static bool op_load_ri(DisasContext *s, arg_ldst_ri *a,
      * ensure correct behavior with overlapping index registers.
      */
     op_addr_ri_post(s, a, addr, 0);
+    s->bx_return = a->rt == 15 && a->rn == 13;
     store_reg_from_load(s, a->rt, tmp);
     return true;
 }
@@ -8018,6 +8784,8 @@ static bool do_ldm(DisasContext *s, arg_ldst_block *a)
         } else if (i == 15 && exc_return) {
             store_pc_exc_ret(s, tmp);
         } else {
+            /* POP {..., pc} */
+            s->bx_return = i == 15 && a->rn == 13;
             store_reg_from_load(s, i, tmp);
         }
 
@@ -8121,7 +8889,7 @@ static bool trans_CLRM(DisasContext *s, arg_CLRM *a)
 
 static bool trans_B(DisasContext *s, arg_i *a)
 {
-    gen_jmp(s, jmp_diff(s, a->imm));
+    gen_jmp_or_follow(s, jmp_diff(s, a->imm));
     return true;
 }
 
@@ -8136,13 +8904,14 @@ static bool trans_B_cond_thumb(DisasContext *s, arg_ci *a)
         return true;
     }
     arm_skip_unless(s, a->cond);
-    gen_jmp(s, jmp_diff(s, a->imm));
+    gen_jmp_or_follow(s, jmp_diff(s, a->imm));
     return true;
 }
 
 static bool trans_BL(DisasContext *s, arg_i *a)
 {
     gen_pc_plus_diff(s, cpu_R[14], curr_insn_len(s) | s->thumb);
+    translator_push_return(&s->base);
     gen_jmp(s, jmp_diff(s, a->imm));
     return true;
 }
@@ -8162,6 +8931,7 @@ static bool trans_BLX_i(DisasContext *s, arg_BLX_i *a)
         return false;
     }
     gen_pc_plus_diff(s, cpu_R[14], curr_insn_len(s) | s->thumb);
+    translator_push_return(&s->base);
     store_cpu_field_constant(!s->thumb, thumb);
     /* This jump is computed from an aligned PC: subtract off the low bits. */
     gen_jmp(s, jmp_diff(s, a->imm - (s->pc_curr & 3)));
@@ -8182,6 +8952,7 @@ static bool trans_BL_suffix(DisasContext *s, arg_BL_suffix *a)
     assert(!arm_dc_feature(s, ARM_FEATURE_THUMB2));
     tcg_gen_addi_i32(tmp, cpu_R[14], (a->imm << 1) | 1);
     gen_pc_plus_diff(s, cpu_R[14], curr_insn_len(s) | 1);
+    translator_push_return(&s->base);
     gen_bx(s, tmp);
     return true;
 }
@@ -8198,6 +8969,7 @@ static bool trans_BLX_suffix(DisasContext *s, arg_BLX_suffix *a)
     tcg_gen_addi_i32(tmp, cpu_R[14], a->imm << 1);
     tcg_gen_andi_i32(tmp, tmp, 0xfffffffc);
     gen_pc_plus_diff(s, cpu_R[14], curr_insn_len(s) | 1);
+    translator_push_return(&s->base);
     gen_bx(s, tmp);
     return true;
 }
@@ -8707,6 +9479,7 @@ static bool trans_DSB(DisasContext *s, arg_DSB *a)
         return false;
     }
     tcg_gen_mb(TCG_MO_ALL | TCG_BAR_SC);
+    gen_tlbi_batch_flush(s);
     return true;
 }
 
@@ -8725,6 +9498,7 @@ static bool trans_ISB(DisasContext *s, arg_ISB *a)
      * self-modifying code correctly and also to take
      * any pending interrupts immediately.
      */
+    gen_tlbi_batch_flush(s);
     s->base.is_jmp = DISAS_TOO_MANY;
     return true;
 }
@@ -8793,6 +9567,8 @@ static bool trans_IT(DisasContext *s, arg_IT *a)
      */
     s->condexec_cond = (cond_mask >> 4) & 0xe;
     s->condexec_mask = cond_mask & 0x1f;
+    /* IT does not touch the flags */
+    s->cc_sub_keep = s->cc_sub;
     return true;
 }
 
@@ -9171,6 +9947,7 @@ static void arm_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     }
     dc->lse2 = false; /* applies only to aarch64 */
     dc->cp_regs = cpu->cp_regs;
+    dc->cp15_table = cpu->cp15_table;
     dc->features = env->features;
 
     /* Single step state. The code-generation logic here is:
@@ -9191,6 +9968,10 @@ static void arm_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     dc->ss_active = EX_TBFLAG_ANY(tb_flags, SS_ACTIVE);
     dc->pstate_ss = EX_TBFLAG_ANY(tb_flags, PSTATE__SS);
     dc->is_ldex = false;
+    dc->pred_cond = TCG_COND_ALWAYS;
+    dc->it_cc_base = -1;
+    dc->cc_sub = false;
+    dc->cc_sub_keep = false;
 
     dc->page_start = dc->base.pc_first & TARGET_PAGE_MASK;
 
@@ -9330,6 +10111,8 @@ static void arm_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     uint32_t pc = dc->base.pc_next;
     unsigned int insn;
 
+    arm_advance_cc_sub(dc);
+
     /* Singlestep exceptions have the highest priority. */
     if (arm_check_ss_active(dc)) {
         dc->base.pc_next = pc + 4;
@@ -9359,7 +10142,9 @@ static void arm_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     insn = arm_ldl_code(env, &dc->base, pc, dc->sctlr_b);
     dc->insn = insn;
     dc->base.pc_next = pc + 4;
-    disas_arm_insn(dc, insn);
+    if (!arm_gen_excl_loop(dc, env, insn)) {
+        disas_arm_insn(dc, insn);
+    }
 
     arm_post_translate_insn(dc);
 
@@ -9413,6 +10198,368 @@ static bool thumb_insn_is_unconditional(DisasContext *s, uint32_t insn)
     return false;
 }
 
+/*
+ * Return true if the Thumb insn only computes a value into a general
+ * register other than SP or PC through store_reg(), without touching the
+ * flags, memory or any other state, and cannot UNDEF on a core that has
+ * IT. Inside an IT block such an insn can be translated unconditionally
+ * with a select on the result instead of a branch around it.
+ */
+static bool thumb_insn_is_predicable(uint32_t insn, bool is_16bit)
+{
+    int rd;
+
+    if (is_16bit) {
+        if (insn < 0x2000) {
+            /* LSL, LSR, ASR (immediate); ADD, SUB (3 operand) */
+            return true;
+        }
+        if ((insn & 0xe000) == 0x2000) {
+            /* MOV, ADD, SUB (8-bit immediate); not CMP */
+            return (insn & 0xf800) != 0x2800;
+        }
+        if ((insn & 0xfc00) == 0x4000) {
+            /* Data processing (register); not TST, CMP, CMN */
+            switch (extract32(insn, 6, 4)) {
+            case 0x8:
+            case 0xa:
+            case 0xb:
+                return false;
+            default:
+                return true;
+            }
+        }
+        if ((insn & 0xfd00) == 0x4400) {
+            /* ADD, MOV (high registers) */
+            rd = extract32(insn, 7, 1) << 3 | extract32(insn, 0, 3);
+            return rd != 13 && rd != 15;
+        }
+        if ((insn & 0xff00) == 0xb200) {
+            /* SXTH, SXTB, UXTH, UXTB */
+            return true;
+        }
+        if ((insn & 0xff00) == 0xba00) {
+            /* REV, REV16, REVSH; not HLT */
+            return extract32(insn, 6, 2) != 2;
+        }
+        return false;
+    }
+
+    rd = extract32(insn, 8, 4);
+    if (rd == 13 || rd == 15) {
+        return false;
+    }
+    if ((insn & 0xfa108000) == 0xf0000000 ||
+        (insn & 0xfe108000) == 0xea000000) {
+        /* Data processing (modified immediate, shifted register), S=0 */
+        switch (extract32(insn, 21, 4)) {
+        case 0x2: /* ORR, MOV */
+        case 0x3: /* ORN, MVN */
+            return true;
+        case 0x0: /* AND */
+        case 0x1: /* BIC */
+        case 0x4: /* EOR */
+        case 0x8: /* ADD */
+        case 0xa: /* ADC */
+        case 0xb: /* SBC */
+        case 0xd: /* SUB */
+        case 0xe: /* RSB */
+            return extract32(insn, 16, 4) != 15;
+        default:
+            return false;
+        }
+    }
+    /* MOVW, MOVT */
+    return (insn & 0xfb708000) == 0xf2400000;
+}
+
+/*
+ * Set up predicated translation of the current insn under IT condition
+ * @cond. The base condition is evaluated into a temp once and shared by
+ * the following insns of the block; the low bit of @cond only selects
+ * which way the result is committed.
+ */
+static void gen_it_predicate(DisasContext *s, int cond)
+{
+    if (s->it_cc_base != (cond & 0xe)) {
+        TCGCond c = arm_cc_sub_cond(s, cond & 0xe);
+
+        s->it_cc = tcg_temp_new_i32();
+        if (c != TCG_COND_NEVER) {
+            tcg_gen_setcond_i32(c, s->it_cc, s->cc_src1, s->cc_src2);
+        } else {
+            DisasCompare cmp;
+
+            arm_test_cc(&cmp, cond & 0xe);
+            tcg_gen_setcondi_i32(cmp.cond, s->it_cc, cmp.value, 0);
+        }
+        s->it_cc_base = cond & 0xe;
+    }
+    s->pred_cond = cond & 1 ? TCG_COND_EQ : TCG_COND_NE;
+}
+
+/* Read the T16 or T32 insn at @pc for thumb_gen_excl_loop(). */
+static uint32_t thumb_excl_ld_insn(DisasContext *s, CPUARMState *env,
+                                   uint32_t pc, int *len)
+{
+    uint32_t insn = arm_lduw_code(env, &s->base, pc, s->sctlr_b);
+
+    if (thumb_insn_is_16bit(s, pc, insn)) {
+        *len = 2;
+        return insn;
+    }
+    *len = 4;
+    return insn << 16 | arm_lduw_code(env, &s->base, pc + 2, s->sctlr_b);
+}
+
+/* Return the ExclCheck of @insn testing @reg against zero, or -1. */
+static int thumb_excl_check(uint32_t insn, int len, int reg)
+{
+    if (len == 2) {
+        if (reg < 8 && insn == (0x2800 | reg << 8)) {
+            return EXCL_CHECK_CMP;
+        }
+        if (reg < 8 && (insn & 0xfd07) == (0xb900 | reg)) {
+            return EXCL_CHECK_CBNZ;
+        }
+        return -1;
+    }
+    if (insn == (0xf1b00f00 | reg << 16)) {
+        return EXCL_CHECK_CMP;
+    }
+    if (insn == (0xf0900f00 | reg << 16)) {
+        return EXCL_CHECK_TEQ;
+    }
+    return -1;
+}
+
+/* Return true if @insn at @pc is a BNE to @dest. */
+static bool thumb_excl_bne(uint32_t insn, int len, uint32_t pc, uint32_t dest)
+{
+    int32_t offset;
+
+    if (len == 2) {
+        if ((insn & 0xff00) != 0xd100) {
+            return false;
+        }
+        offset = sextract32(insn, 0, 8) * 2;
+    } else {
+        if ((insn & 0xfbc0d000) != 0xf0408000) {
+            return false;
+        }
+        /* S:J2:J1:imm6:imm11:'0' */
+        offset = sextract32(extract32(insn, 26, 1) << 20 |
+                            extract32(insn, 11, 1) << 19 |
+                            extract32(insn, 13, 1) << 18 |
+                            extract32(insn, 16, 6) << 12 |
+                            extract32(insn, 0, 11) << 1, 0, 21);
+    }
+    return pc + 4 + offset == dest;
+}
+
+/*
+ * Match @insn as the <op> of an exclusive loop whose rt is already set
+ * in @l, filling in the rest of the operation. The T16 forms outside an
+ * IT block and the T32 forms with S set the flags, see @sets_flags.
+ */
+static bool thumb_excl_op(DisasContext *s, uint32_t insn, int len,
+                          ExclLoop *l, bool *sets_flags)
+{
+    int rn, x;
+
+    if (len == 4) {
+        if ((insn & 0xfa008000) == 0xf0000000) {
+            /* Modified immediate */
+            x = extract32(insn, 26, 1) << 11 | extract32(insn, 12, 3) << 8 |
+                extract32(insn, 0, 8);
+            l->is_imm = true;
+            l->imm = ror32(t32_expandimm_imm(s, x), t32_expandimm_rot(s, x));
+        } else if ((insn & 0xfe00f0f0) == 0xea000000) {
+            /* Register operand without shift */
+            l->rm = extract32(insn, 0, 4);
+        } else {
+            return false;
+        }
+        switch (extract32(insn, 21, 4)) {
+        case 0x0:
+            l->op = 0x0; /* AND */
+            break;
+        case 0x1:
+            l->op = 0xe; /* BIC */
+            break;
+        case 0x2:
+            l->op = 0xc; /* ORR */
+            break;
+        case 0x4:
+            l->op = 0x1; /* EOR */
+            break;
+        case 0x8:
+            l->op = 0x4; /* ADD */
+            break;
+        case 0xd:
+            l->op = 0x2; /* SUB */
+            break;
+        default:
+            return false;
+        }
+        *sets_flags = extract32(insn, 20, 1);
+        rn = extract32(insn, 16, 4);
+        l->rt2 = extract32(insn, 8, 4);
+    } else if ((insn & 0xf800) == 0x1800) {
+        /* ADDS/SUBS rd, rn, rm|#imm3 */
+        l->op = insn & (1 << 9) ? 0x2 : 0x4;
+        if (insn & (1 << 10)) {
+            l->is_imm = true;
+            l->imm = extract32(insn, 6, 3);
+        } else {
+            l->rm = extract32(insn, 6, 3);
+        }
+        rn = extract32(insn, 3, 3);
+        l->rt2 = extract32(insn, 0, 3);
+        *sets_flags = true;
+    } else if ((insn & 0xf000) == 0x3000) {
+        /* ADDS/SUBS rdn, #imm8 */
+        l->op = insn & (1 << 11) ? 0x2 : 0x4;
+        l->is_imm = true;
+        l->imm = extract32(insn, 0, 8);
+        rn = l->rt2 = extract32(insn, 8, 3);
+        *sets_flags = true;
+    } else if ((insn & 0xfc00) == 0x4000) {
+        /* ANDS/EORS/ORRS/BICS rdn, rm, numbered as in A32 */
+        l->op = extract32(insn, 6, 4);
+        if (l->op != 0x0 && l->op != 0x1 && l->op != 0xc && l->op != 0xe) {
+            return false;
+        }
+        l->rm = extract32(insn, 3, 3);
+        rn = l->rt2 = extract32(insn, 0, 3);
+        *sets_flags = true;
+    } else {
+        return false;
+    }
+    return rn == l->rt;
+}
+
+/*
+ * Match an exclusive retry loop starting with the T32 LDREX @insn and
+ * emit it, see gen_excl_loop(). Besides the A32 shapes this takes
+ * flag-setting ops (T16 ADDS and friends, which are the short forms
+ * outside IT blocks) when the loop ends with a CMP that overwrites all
+ * of the flags, the IT before the STREXEQ of a test-and-set loop, and
+ *
+ *   1: ldrex  rt, [rn]
+ *      <op>   rt2, rt, #imm|rm
+ *      strex  rd, rt2, [rn]
+ *      cbnz   rd, 2f
+ *      ...
+ *   2: b      1b
+ *
+ * where the retry is out of line. Once the store is done the CBNZ is
+ * never taken, so its target is not looked at.
+ * Returns true if the loop was consumed.
+ */
+static bool thumb_gen_excl_loop(DisasContext *s, CPUARMState *env,
+                                uint32_t insn)
+{
+    uint32_t pc = s->pc_curr;
+    uint32_t next_pc = pc + 4;
+    bool sets_flags = false;
+    ExclLoop l = { };
+    uint32_t next;
+    int len, check;
+
+    if (!excl_loop_usable(s) || s->condexec_mask || s->eci) {
+        return false;
+    }
+    /* ldrex rt, [rn] without offset */
+    if ((insn & 0xfff00fff) != 0xe8500f00) {
+        return false;
+    }
+    l.rn = extract32(insn, 16, 4);
+    l.rt = extract32(insn, 12, 4);
+
+    /* The longest loop must sit in the page we are already translating */
+    if (((pc + 21) ^ pc) & TARGET_PAGE_MASK) {
+        return false;
+    }
+
+    next = thumb_excl_ld_insn(s, env, next_pc, &len);
+    check = thumb_excl_check(next, len, l.rt);
+    if (check == EXCL_CHECK_CMP || check == EXCL_CHECK_TEQ) {
+        /* Test-and-set: itt eq; strexeq rd, rm, [rn]; teqeq rd, #0 */
+        l.op = EXCL_LOOP_TAS;
+        l.tas_check = check;
+        next_pc += len;
+        next = thumb_excl_ld_insn(s, env, next_pc, &len);
+        if (len != 2 || next != 0xbf04) {
+            return false;
+        }
+        next_pc += len;
+        next = thumb_excl_ld_insn(s, env, next_pc, &len);
+        if (len != 4 || (next & 0xfff000ff) != 0xe8400000 ||
+            extract32(next, 16, 4) != l.rn) {
+            return false;
+        }
+        l.rm = extract32(next, 12, 4);
+        l.rd = extract32(next, 8, 4);
+        next_pc += len;
+        next = thumb_excl_ld_insn(s, env, next_pc, &len);
+        check = thumb_excl_check(next, len, l.rd);
+        if (check == EXCL_CHECK_CBNZ) {
+            return false;
+        }
+    } else {
+        l.op = EXCL_LOOP_SWAP;
+        l.rt2 = l.rt;
+        if (thumb_excl_op(s, next, len, &l, &sets_flags)) {
+            next_pc += len;
+            next = thumb_excl_ld_insn(s, env, next_pc, &len);
+        } else if (l.op != EXCL_LOOP_SWAP) {
+            return false;
+        }
+
+        /* strex rd, rt2, [rn] without offset */
+        if (len != 4 || (next & 0xfff000ff) != 0xe8400000 ||
+            extract32(next, 16, 4) != l.rn) {
+            return false;
+        }
+        l.rd = extract32(next, 8, 4);
+        if (l.op == EXCL_LOOP_SWAP) {
+            /* Swap: the stored register is the operand */
+            l.rm = extract32(next, 12, 4);
+        } else if (extract32(next, 12, 4) != l.rt2) {
+            return false;
+        }
+        next_pc += len;
+        next = thumb_excl_ld_insn(s, env, next_pc, &len);
+        check = thumb_excl_check(next, len, l.rd);
+        if (sets_flags && check != EXCL_CHECK_CMP) {
+            return false;
+        }
+    }
+    if (check < 0) {
+        return false;
+    }
+    l.check = check;
+    next_pc += len;
+
+    if (check != EXCL_CHECK_CBNZ) {
+        /* bne back to the ldrex */
+        next = thumb_excl_ld_insn(s, env, next_pc, &len);
+        if (!thumb_excl_bne(next, len, next_pc, pc)) {
+            return false;
+        }
+        next_pc += len;
+    }
+
+    /* SP is UNPREDICTABLE as anything but the base */
+    if (!excl_loop_regs_ok(&l, 13)) {
+        return false;
+    }
+    l.len = next_pc - pc;
+    gen_excl_loop(s, &l);
+    return true;
+}
+
 static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
 {
     DisasContext *dc = container_of(dcbase, DisasContext, base);
@@ -9427,6 +10574,8 @@ static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
     /* Misaligned thumb PC is architecturally impossible. */
     assert((dc->base.pc_next & 1) == 0);
 
+    arm_advance_cc_sub(dc);
+
     if (arm_check_ss_active(dc) || arm_check_kernelpage(dc)) {
         dc->base.pc_next = pc + 2;
         return;
@@ -9496,16 +10645,28 @@ static void thumb_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
          * "always"; 0xf is not "never".
          */
         if (cond < 0x0e) {
-            arm_skip_unless(dc, cond);
+            if (!dc->eci && thumb_insn_is_predicable(insn, is_16bit)) {
+                gen_it_predicate(dc, cond);
+            } else {
+                arm_skip_unless(dc, cond);
+            }
         }
     }
 
     if (is_16bit) {
         disas_thumb_insn(dc, insn);
-    } else {
+    } else if (!thumb_gen_excl_loop(dc, env, insn)) {
         disas_thumb2_insn(dc, insn);
     }
 
+    if (dc->pred_cond != TCG_COND_ALWAYS) {
+        dc->pred_cond = TCG_COND_ALWAYS;
+        dc->cc_sub_keep = dc->cc_sub;
+    } else {
+        /* Anything not predicated may have written the flags */
+        dc->it_cc_base = -1;
+    }
+
     /* Advance the Thumb condexec condition.  */
     if (dc->condexec_mask) {
         dc->condexec_cond = ((dc->condexec_cond & 0xe) |
@@ -9609,10 +10770,11 @@ static void arm_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
             break;
         case DISAS_UPDATE_NOCHAIN:
             gen_update_pc(dc, curr_insn_len(dc));
-            /* fall through */
-        case DISAS_JUMP:
             gen_goto_ptr();
             break;
+        case DISAS_JUMP:
+            gen_goto_ptr_bx(dc);
+            break;
         case DISAS_UPDATE_EXIT:
             gen_update_pc(dc, curr_insn_len(dc));
             /* fall through */
@@ -9660,6 +10822,12 @@ static void arm_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
             gen_goto_tb(dc, 1, curr_insn_len(dc));
         }
     }
+
+    for (int i = 0; i < dc->num_trace_exits; i++) {
+        set_disas_label(dc, dc->trace_exit[i].label);
+        gen_update_pc(dc, dc->trace_exit[i].pc - dc->pc_curr);
+        gen_goto_ptr();
+    }
 }
 
 static void arm_tr_disas_log(const DisasContextBase *dcbase,
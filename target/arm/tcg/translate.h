@@ -47,9 +47,45 @@ typedef struct DisasContext {
     int condjmp;
     /* The label that will be jumped to when the instruction is skipped.  */
     DisasLabel condlabel;
+    /*
+     * Exits from a CF_TRACE TB for conditional branches whose taken
+     * path was followed: the condition-failed code goes to @pc.
+     */
+    struct {
+        DisasLabel label;
+        target_ulong pc;
+    } trace_exit[TB_TRACE_MAX];
+    int num_trace_exits;
+    /*
+     * The operand of the gen_bx() that ends the TB, and whether that is
+     * a function return, for translator_goto_ptr_cached().
+     */
+    TCGv_i32 bx_key;
+    bool bx_return;
     /* Thumb-2 conditional execution bits.  */
     int condexec_mask;
     int condexec_cond;
+    /*
+     * IT-block predication: unless pred_cond is TCG_COND_ALWAYS, the insn
+     * being translated is executed unconditionally and store_reg() only
+     * commits its result if (it_cc pred_cond 0). it_cc holds the IT base
+     * condition it_cc_base, evaluated once and reused until an insn that
+     * may change the flags is translated (-1 if not valid).
+     */
+    TCGCond pred_cond;
+    int it_cc_base;
+    TCGv_i32 it_cc;
+    /*
+     * Lazy condition codes: while cc_sub is set, NZCV are known to be the
+     * flags of cc_src1 - cc_src2 from an unconditional CMP/SUBS, so a
+     * condition test can compare the operands instead of decoding NZCV.
+     * This holds for the insn after the CMP/SUBS, and across IT and
+     * predicated insns while cc_sub_keep is set.
+     */
+    bool cc_sub;
+    bool cc_sub_keep;
+    TCGv_i32 cc_src1;
+    TCGv_i32 cc_src2;
     /* M-profile ECI/ICI exception-continuable instruction state */
     int eci;
     /*
@@ -87,6 +123,7 @@ typedef struct DisasContext {
     uint32_t svc_imm;
     int current_el;
     GHashTable *cp_regs;
+    struct ARMCP15Table *cp15_table;
     uint64_t features; /* CPU features bits */
     bool aarch64;
     bool thumb;
@@ -451,6 +488,19 @@ void gen_gvec_sqrdmlah_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
                           uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
 void gen_gvec_sqrdmlsh_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
                           uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_sqdmulh_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                         uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_sqrdmulh_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                          uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
+
+void gen_gvec_saddlp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_uaddlp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_sadalp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_uadalp(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                     uint32_t opr_sz, uint32_t max_sz);
 
 void gen_gvec_sabd(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
                    uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
@@ -85,6 +85,28 @@ static inline int vfp_exceptbits_to_host(int target_bits)
     return host_bits;
 }
 
+/*
+ * softfloat only takes its host FPU fast path (see can_use_fpu()) while
+ * float_flag_inexact is already raised in the float_status, because the
+ * host FPU does not report inexactness cheaply. Guests clear FPSCR.IXC
+ * on every context switch, which sends VFP and Neon arithmetic back
+ * through the slow path until the next inexact result.
+ *
+ * With the x-vfp-hardfloat CPU property set, inexact is kept raised in
+ * every float_status, so that round-to-nearest arithmetic runs on the
+ * host FPU. Other rounding modes, NaNs, denormals and results near the
+ * underflow threshold still go through softfloat, so results and the
+ * other cumulative flags are unaffected. The price is that FPSCR.IXC no
+ * longer tracks arithmetic and reads back as the guest last wrote it.
+ */
+static void vfp_hardfloat_raise_inexact(CPUARMState *env)
+{
+    float_raise(float_flag_inexact, &env->vfp.fp_status);
+    float_raise(float_flag_inexact, &env->vfp.fp_status_f16);
+    float_raise(float_flag_inexact, &env->vfp.standard_fp_status);
+    float_raise(float_flag_inexact, &env->vfp.standard_fp_status_f16);
+}
+
 static uint32_t vfp_get_fpscr_from_host(CPUARMState *env)
 {
     uint32_t i;
@@ -96,6 +118,10 @@ static uint32_t vfp_get_fpscr_from_host(CPUARMState *env)
           & ~float_flag_input_denormal);
     i |= (get_float_exception_flags(&env->vfp.standard_fp_status_f16)
           & ~float_flag_input_denormal);
+    if (env_archcpu(env)->vfp_hardfloat) {
+        /* IXC is kept in vfp.xregs[FPSCR] instead */
+        i &= ~float_flag_inexact;
+    }
     return vfp_exceptbits_from_host(i);
 }
 
@@ -152,6 +178,9 @@ static void vfp_set_fpscr_to_host(CPUARMState *env, uint32_t val)
     set_float_exception_flags(0, &env->vfp.fp_status_f16);
     set_float_exception_flags(0, &env->vfp.standard_fp_status);
     set_float_exception_flags(0, &env->vfp.standard_fp_status_f16);
+    if (env_archcpu(env)->vfp_hardfloat) {
+        vfp_hardfloat_raise_inexact(env);
+    }
 }
 
 #else
@@ -241,9 +270,13 @@ void HELPER(vfp_set_fpscr)(CPUARMState *env, uint32_t val)
      * The exception flags IOC|DZC|OFC|UFC|IXC|IDC are stored in
      * fp_status; QC, Len and Stride are stored separately earlier.
      * Clear out all of those and the RES0 bits: only NZCV, AHP, DN,
-     * FZ, RMode and FZ16 are kept in vfp.xregs[FPSCR].
+     * FZ, RMode and FZ16 are kept in vfp.xregs[FPSCR], plus IXC when
+     * x-vfp-hardfloat is set.
      */
     env->vfp.xregs[ARM_VFP_FPSCR] = val & 0xf7c80000;
+    if (cpu->vfp_hardfloat) {
+        env->vfp.xregs[ARM_VFP_FPSCR] |= val & FPCR_IXC;
+    }
 }
 
 void vfp_set_fpscr(CPUARMState *env, uint32_t val)
@@ -52,6 +52,26 @@ struct tcg_region_tree {
     /* padding to avoid false sharing is computed at run-time */
 };
 
+/*
+ * Once every region has been handed out, the oldest full regions are
+ * emptied and handed out again, so that the code generated most recently
+ * survives instead of flushing the whole buffer.
+ */
+enum tcg_region_status {
+    TCG_REGION_FREE,
+    TCG_REGION_ACTIVE, /* being filled by a TCGContext */
+    TCG_REGION_FULL,
+};
+
+struct tcg_region_use {
+    enum tcg_region_status state;
+    uint64_t gen; /* value of region.n_allocs when handed out */
+    size_t size_full; /* contribution to agg_size_full once full */
+};
+
+/* Reclaim at least this fraction of the buffer at a time */
+#define TCG_REGION_RECLAIM_DIV 8
+
 /*
  * We divide code_gen_buffer into equally-sized "regions" that TCG threads
  * dynamically allocate from as demand dictates. Given appropriate region
@@ -72,6 +92,8 @@ struct tcg_region_state {
     /* fields protected by the lock */
     size_t current; /* current region index */
     size_t agg_size_full; /* aggregate size of full regions */
+    uint64_t n_allocs; /* number of regions handed out so far */
+    struct tcg_region_use *use; /* .n entries */
 };
 
 static struct tcg_region_state region;
@@ -191,10 +213,23 @@ static void tcg_region_trees_init(void)
     }
 }
 
-static struct tcg_region_tree *tc_ptr_to_region_tree(const void *p)
+/* Return the index of the region containing @p in the rw buffer. */
+static size_t tcg_region_index(const void *p)
 {
-    size_t region_idx;
+    if (p < region.start_aligned) {
+        return 0;
+    } else {
+        ptrdiff_t offset = p - region.start_aligned;
 
+        if (offset > region.stride * (region.n - 1)) {
+            return region.n - 1;
+        }
+        return offset / region.stride;
+    }
+}
+
+static struct tcg_region_tree *tc_ptr_to_region_tree(const void *p)
+{
     /*
      * Like tcg_splitwx_to_rw, with no assert.  The pc may come from
      * a signal handler over which the caller has no control.
@@ -205,19 +240,7 @@ static struct tcg_region_tree *tc_ptr_to_region_tree(const void *p)
             return NULL;
         }
     }
-
-    if (p < region.start_aligned) {
-        region_idx = 0;
-    } else {
-        ptrdiff_t offset = p - region.start_aligned;
-
-        if (offset > region.stride * (region.n - 1)) {
-            region_idx = region.n - 1;
-        } else {
-            region_idx = offset / region.stride;
-        }
-    }
-    return region_trees + region_idx * tree_size;
+    return region_trees + tcg_region_index(p) * tree_size;
 }
 
 void tcg_tb_insert(TranslationBlock *tb)
@@ -359,11 +382,24 @@ static void tcg_region_assign(TCGContext *s, size_t curr_region)
 
 static bool tcg_region_alloc__locked(TCGContext *s)
 {
-    if (region.current == region.n) {
-        return true;
+    size_t i = region.current;
+
+    if (i == region.n) {
+        /* Reuse a region emptied by tcg_region_reclaim(), if any */
+        for (i = 0; i < region.n; i++) {
+            if (region.use[i].state == TCG_REGION_FREE) {
+                break;
+            }
+        }
+        if (i == region.n) {
+            return true;
+        }
+    } else {
+        region.current++;
     }
-    tcg_region_assign(s, region.current);
-    region.current++;
+    tcg_region_assign(s, i);
+    region.use[i].state = TCG_REGION_ACTIVE;
+    region.use[i].gen = region.n_allocs++;
     return false;
 }
 
@@ -376,11 +412,14 @@ bool tcg_region_alloc(TCGContext *s)
     bool err;
     /* read the region size now; alloc__locked will overwrite it on success */
     size_t size_full = s->code_gen_buffer_size;
+    size_t full = tcg_region_index(s->code_gen_buffer);
 
     qemu_mutex_lock(&region.lock);
     err = tcg_region_alloc__locked(s);
     if (!err) {
         region.agg_size_full += size_full - TCG_HIGHWATER;
+        region.use[full].state = TCG_REGION_FULL;
+        region.use[full].size_full = size_full - TCG_HIGHWATER;
     }
     qemu_mutex_unlock(&region.lock);
     return err;
@@ -412,6 +451,9 @@ void tcg_region_reset_all(void)
     qemu_mutex_lock(&region.lock);
     region.current = 0;
     region.agg_size_full = 0;
+    for (i = 0; i < region.n; i++) {
+        region.use[i].state = TCG_REGION_FREE;
+    }
 
     for (i = 0; i < n_ctxs; i++) {
         TCGContext *s = qatomic_read(&tcg_ctxs[i]);
@@ -422,7 +464,86 @@ void tcg_region_reset_all(void)
     tcg_region_tree_reset_all();
 }
 
-static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
+static gboolean tcg_region_collect_tb(gpointer key, gpointer value,
+                                      gpointer data)
+{
+    g_ptr_array_add(data, value);
+    return FALSE;
+}
+
+/*
+ * Call from a safe-work context, once tcg_region_alloc() has failed.
+ * Empty the oldest full regions, at least 1/TCG_REGION_RECLAIM_DIV of
+ * the buffer, so that they can be handed out again.  @func is called on
+ * each TB in them first, to unlink it from the rest of the code; the TBs
+ * are freed when this returns.
+ * Returns false if no region can be reclaimed, e.g. because all of them
+ * are being filled; the caller must then reset all regions.
+ */
+bool tcg_region_reclaim(GFunc func, gpointer user_data)
+{
+    size_t want = DIV_ROUND_UP(region.n, TCG_REGION_RECLAIM_DIV);
+    g_autofree size_t *victims = g_new(size_t, want);
+    size_t n_victims = 0;
+    size_t i, j;
+
+    qemu_mutex_lock(&region.lock);
+    for (i = 0; i < region.n; i++) {
+        struct tcg_region_use *u = &region.use[i];
+
+        if (u->state == TCG_REGION_FREE) {
+            /* Someone else got here first */
+            qemu_mutex_unlock(&region.lock);
+            return true;
+        }
+        if (u->state != TCG_REGION_FULL) {
+            continue;
+        }
+        /* Keep the @want oldest in @victims, oldest first */
+        for (j = n_victims; j > 0 && region.use[victims[j - 1]].gen > u->gen;
+             j--) {
+            if (j < want) {
+                victims[j] = victims[j - 1];
+            }
+        }
+        if (j < want) {
+            victims[j] = i;
+            n_victims = MIN(n_victims + 1, want);
+        }
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    for (j = 0; j < n_victims; j++) {
+        struct tcg_region_tree *rt = region_trees + victims[j] * tree_size;
+        g_autoptr(GPtrArray) tbs = g_ptr_array_new();
+
+        /* @func takes the page locks, which nest outside rt->lock */
+        qemu_mutex_lock(&rt->lock);
+        q_tree_foreach(rt->tree, tcg_region_collect_tb, tbs);
+        qemu_mutex_unlock(&rt->lock);
+
+        g_ptr_array_foreach(tbs, func, user_data);
+
+        qemu_mutex_lock(&rt->lock);
+        /* Increment the refcount first so that destroy acts as a reset */
+        q_tree_ref(rt->tree);
+        q_tree_destroy(rt->tree);
+        qemu_mutex_unlock(&rt->lock);
+    }
+
+    qemu_mutex_lock(&region.lock);
+    for (j = 0; j < n_victims; j++) {
+        struct tcg_region_use *u = &region.use[victims[j]];
+
+        u->state = TCG_REGION_FREE;
+        region.agg_size_full -= u->size_full;
+    }
+    qemu_mutex_unlock(&region.lock);
+
+    return n_victims != 0;
+}
+
+static size_t tcg_n_regions(size_t tb_size, unsigned max_threads)
 {
 #ifdef CONFIG_USER_ONLY
     return 1;
@@ -430,25 +551,22 @@ static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
     size_t n_regions;
 
     /*
-     * It is likely that some vCPUs will translate more code than others,
-     * so we first try to set more regions than max_cpus, with those regions
-     * being of reasonable size. If that's not possible we make do by evenly
-     * dividing the code_gen_buffer among the vCPUs.
+     * It is likely that some threads will translate more code than others,
+     * so we first try to set more regions than max_threads, with those
+     * regions being of reasonable size. If that's not possible we make do
+     * by evenly dividing the code_gen_buffer among the threads.
+     * A single TCG thread gets several regions as well, so that only the
+     * oldest of them need to be reclaimed when the buffer fills up.
      */
-    /* Use a single region if all we have is one vCPU thread */
-    if (max_cpus == 1 || !qemu_tcg_mttcg_enabled()) {
-        return 1;
-    }
-
     /*
-     * Try to have more regions than max_cpus, with each region being >= 2 MB.
-     * If we can't, then just allocate one region per vCPU thread.
+     * Try to have more regions than max_threads, with each region being
+     * >= 2 MB.  If we can't, then just allocate one region per thread.
      */
     n_regions = tb_size / (2 * MiB);
-    if (n_regions <= max_cpus) {
-        return max_cpus;
+    if (n_regions <= max_threads) {
+        return max_threads;
     }
-    return MIN(n_regions, max_cpus * 8);
+    return MIN(n_regions, max_threads * 8);
 #endif
 }
 
@@ -733,11 +851,9 @@ static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
  * and then assigning regions to TCG threads so that the threads can translate
  * code in parallel without synchronization.
  *
- * In system-mode the number of TCG threads is bounded by max_cpus, so we use at
- * least max_cpus regions in MTTCG. In !MTTCG we use a single region.
- * Note that the TCG options from the command-line (i.e. -accel accel=tcg,[...])
- * must have been parsed before calling this function, since it calls
- * qemu_tcg_mttcg_enabled().
+ * In system-mode the number of TCG threads is bounded by max_threads, so we
+ * use at least max_threads regions.  With a single thread (e.g. !MTTCG) we
+ * use a single region.
  *
  * In user-mode we use a single region.  Having multiple regions in user-mode
  * is not supported, because the number of vCPU threads (recall that each thread
@@ -751,7 +867,7 @@ static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
  * in practice. Multi-threaded guests share most if not all of their translated
  * code, which makes parallel code generation less appealing than in system-mode
  */
-void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
+void tcg_region_init(size_t tb_size, int splitwx, unsigned max_threads)
 {
     const size_t page_size = qemu_real_host_page_size();
     size_t region_size;
@@ -789,7 +905,7 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
      * As a result of this we might end up with a few extra pages at the end of
      * the buffer; we will assign those to the last region.
      */
-    region.n = tcg_n_regions(tb_size, max_cpus);
+    region.n = tcg_n_regions(tb_size, max_threads);
     region_size = tb_size / region.n;
     region_size = QEMU_ALIGN_DOWN(region_size, page_size);
 
@@ -810,6 +926,7 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
 
     /* init the region struct */
     qemu_mutex_init(&region.lock);
+    region.use = g_new0(struct tcg_region_use, region.n);
 
     /*
      * Set guard pages in the rw buffer, as that's the one into which
@@ -3284,6 +3284,23 @@ void tcg_gen_st_i128(TCGv_i128 val, TCGv_ptr base, tcg_target_long offset)
 
 /* QEMU specific operations.  */
 
+/* Count an event in the profile of the TB being generated. */
+static void gen_tb_prof_inc(size_t ofs)
+{
+    TCGv_ptr ptr;
+    TCGv_i64 t;
+
+    if (!tcg_ctx->tb_profile) {
+        return;
+    }
+    ptr = tcg_constant_ptr(tcg_ctx->gen_tb);
+    t = tcg_temp_ebb_new_i64();
+    tcg_gen_ld_i64(t, ptr, ofs);
+    tcg_gen_addi_i64(t, t, 1);
+    tcg_gen_st_i64(t, ptr, ofs);
+    tcg_temp_free_i64(t);
+}
+
 void tcg_gen_exit_tb(const TranslationBlock *tb, unsigned idx)
 {
     /*
@@ -3307,11 +3324,14 @@ void tcg_gen_exit_tb(const TranslationBlock *tb, unsigned idx)
            seen this numbered exit before, via tcg_gen_goto_tb.  */
         tcg_debug_assert(tcg_ctx->goto_tb_issue_mask & (1 << idx));
 #endif
+        /* Reached only until the goto_tb is chained.  */
+        gen_tb_prof_inc(offsetof(TranslationBlock, prof.unchained));
     } else {
         /* This is an exit via the exitreq label.  */
         tcg_debug_assert(idx == TB_EXIT_REQUESTED);
     }
 
+    gen_tb_prof_inc(offsetof(TranslationBlock, prof.exit));
     tcg_gen_op1i(INDEX_op_exit_tb, val);
 }
 
@@ -3327,6 +3347,7 @@ void tcg_gen_goto_tb(unsigned idx)
     tcg_ctx->goto_tb_issue_mask |= 1 << idx;
 #endif
     plugin_gen_disable_mem_helpers();
+    gen_tb_prof_inc(offsetof(TranslationBlock, prof.goto_tb));
     tcg_gen_op1i(INDEX_op_goto_tb, idx);
 }
 
@@ -3342,6 +3363,13 @@ void tcg_gen_lookup_and_goto_ptr(void)
     plugin_gen_disable_mem_helpers();
     ptr = tcg_temp_ebb_new_ptr();
     gen_helper_lookup_tb_ptr(ptr, tcg_env);
-    tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
+    tcg_gen_goto_ptr(ptr);
     tcg_temp_free_ptr(ptr);
 }
+
+void tcg_gen_goto_ptr(TCGv_ptr ptr)
+{
+    tcg_debug_assert(!(tcg_ctx->gen_tb->cflags & CF_NO_GOTO_PTR));
+    gen_tb_prof_inc(offsetof(TranslationBlock, prof.lookup));
+    tcg_gen_op1i(INDEX_op_goto_ptr, tcgv_ptr_arg(ptr));
+}
@@ -0,0 +1,165 @@
+/*
+ * Boot-time benchmark for the Apple A6 (S5L8950X) SoC
+ *
+ * Boots a SecureROM-style image on the iphone-n42ap board until it stores
+ * a marker word, then reports wall time and guest instructions per second.
+ *
+ * By default a built-in ROM that spins through a counted loop is used, so
+ * the number of retired guest instructions is known up front. A real image
+ * can be benchmarked instead by setting:
+ *
+ *   S5L8950X_BENCH_ROM          path to the image loaded at the VROM base
+ *   S5L8950X_BENCH_MARKER_ADDR  guest physical address polled for the marker
+ *   S5L8950X_BENCH_MARKER       value that signals the end of the run
+ *
+ * in which case the guest runs with -icount shift=0 and the instruction
+ * count is recovered from the AIC timebase.
+ *
+ * S5L8950X_BENCH_ITERATIONS overrides the loop count of the built-in ROM,
+ * S5L8950X_BENCH_TIMEOUT the number of seconds to wait for the marker and
+ * S5L8950X_BENCH_MIN_MIPS turns the benchmark into a regression gate that
+ * fails when throughput drops below the given value.
+ *
+ * Copyright (C) 2024 Iscle <albertiscle9@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "qemu/cutils.h"
+#include "libqtest.h"
+
+#define SRAM_BASE       0x10000000
+#define AIC_BASE        0x3F200000
+#define rAIC_TIME_LO    0x0020
+#define rAIC_TIME_HI    0x0028
+
+#define BENCH_MARKER            0x600db007
+#define BENCH_ITERATIONS        50000000
+#define BENCH_TIMEOUT           120
+#define BENCH_ROM_ITERATIONS    7
+
+/* Counted loop, then store BENCH_MARKER at the base of SRAM and halt */
+static const uint32_t bench_rom[] = {
+    0xe59f0014,     /* 0x00: ldr   r0, [pc, #0x14]      @ iterations */
+    0xe3a01201,     /* 0x04: mov   r1, #0x10000000      @ SRAM */
+    0xe2500001,     /* 0x08: subs  r0, r0, #1 */
+    0x1afffffd,     /* 0x0c: bne   0x08 */
+    0xe59f2008,     /* 0x10: ldr   r2, [pc, #0x8]       @ marker */
+    0xe5812000,     /* 0x14: str   r2, [r1] */
+    0xeafffffe,     /* 0x18: b     0x18 */
+    0x00000000,     /* 0x1c: iterations, patched at run time */
+    BENCH_MARKER,   /* 0x20: marker */
+};
+
+static uint64_t bench_getenv(const char *name, uint64_t def)
+{
+    const char *str = getenv(name);
+    uint64_t val;
+
+    if (!str) {
+        return def;
+    }
+    if (qemu_strtou64(str, NULL, 0, &val) < 0) {
+        g_error("Invalid value for %s: '%s'", name, str);
+    }
+    return val;
+}
+
+static char *bench_write_rom(uint64_t iterations)
+{
+    uint32_t rom[ARRAY_SIZE(bench_rom)];
+    char *romtmp = NULL;
+    ssize_t wlen;
+    int fd, i;
+
+    for (i = 0; i < ARRAY_SIZE(bench_rom); i++) {
+        rom[i] = cpu_to_le32(bench_rom[i]);
+    }
+    rom[BENCH_ROM_ITERATIONS] = cpu_to_le32(iterations);
+
+    fd = g_file_open_tmp("qtest-s5l8950x-bench-XXXXXX", &romtmp, NULL);
+    g_assert(fd != -1);
+    wlen = write(fd, rom, sizeof(rom));
+    g_assert(wlen == sizeof(rom));
+    close(fd);
+
+    return romtmp;
+}
+
+static void bench_boot(void)
+{
+    const char *rom = getenv("S5L8950X_BENCH_ROM");
+    g_autofree char *romtmp = NULL;
+    uint64_t marker_addr, marker, insns;
+    uint64_t timeout_us, min_mips;
+    gint64 start, booted, end;
+    double mips;
+    QTestState *qts;
+
+    if (rom) {
+        marker_addr = bench_getenv("S5L8950X_BENCH_MARKER_ADDR", SRAM_BASE);
+        marker = bench_getenv("S5L8950X_BENCH_MARKER", BENCH_MARKER);
+        insns = 0;
+    } else {
+        uint64_t iterations = bench_getenv("S5L8950X_BENCH_ITERATIONS",
+                                           BENCH_ITERATIONS);
+
+        g_assert(iterations > 0 && iterations <= UINT32_MAX);
+        romtmp = bench_write_rom(iterations);
+        rom = romtmp;
+        marker_addr = SRAM_BASE;
+        marker = BENCH_MARKER;
+        /* ldr + mov, two per iteration, ldr + str */
+        insns = 2 + 2 * iterations + 2;
+    }
+    timeout_us = bench_getenv("S5L8950X_BENCH_TIMEOUT", BENCH_TIMEOUT) *
+                 G_USEC_PER_SEC;
+    min_mips = bench_getenv("S5L8950X_BENCH_MIN_MIPS", 0);
+
+    start = g_get_monotonic_time();
+    qts = qtest_initf("-machine iphone-n42ap -bios %s -accel tcg %s",
+                      rom, insns ? "" : "-icount shift=0,sleep=off");
+    booted = g_get_monotonic_time();
+    if (romtmp) {
+        unlink(romtmp);
+    }
+
+    while (qtest_readl(qts, marker_addr) != (uint32_t)marker) {
+        if (g_get_monotonic_time() - start > timeout_us) {
+            g_error("Marker 0x%08" PRIx64 " not seen at 0x%08" PRIx64
+                    " after %" PRIu64 " seconds", marker, marker_addr,
+                    timeout_us / G_USEC_PER_SEC);
+        }
+        g_usleep(1000);
+    }
+    end = g_get_monotonic_time();
+
+    if (!insns) {
+        /* With icount shift=0 one instruction is one virtual nanosecond */
+        insns = qtest_readl(qts, AIC_BASE + rAIC_TIME_LO) |
+                (uint64_t)qtest_readl(qts, AIC_BASE + rAIC_TIME_HI) << 32;
+    }
+    qtest_quit(qts);
+
+    mips = (double)insns / (end - start);
+    g_test_message("s5l8950x boot: startup %.3f s, wall time %.3f s, "
+                   "%" PRIu64 " guest insns, %.2f MIPS",
+                   (double)(booted - start) / G_USEC_PER_SEC,
+                   (double)(end - start) / G_USEC_PER_SEC, insns, mips);
+
+    if (min_mips) {
+        g_assert_cmpfloat(mips, >=, min_mips);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/s5l8950x/bench/boot", bench_boot);
+
+    return g_test_run();
+}
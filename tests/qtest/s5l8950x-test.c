@@ -0,0 +1,238 @@
+/*
+ * QTest testcase for the Apple A6 (S5L8950X) SoC devices
+ *
+ * Copyright (C) 2024 Iscle <albertiscle9@gmail.com>
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define SPI_BASE(n)     (0x32000000 + (n) * 0x100000)
+#define NUM_SPI         5
+#define AUDIO_BASE      0x34000000
+#define PMGR_BASE       0x3F100000
+#define AIC_BASE        0x3F200000
+#define CHIPID_BASE     0x3F500000
+#define GPIO_BASE       0x3FA00000
+
+#define rAIC_TIME_LO    0x0020
+#define rAIC_TIME_HI    0x0028
+#define rAIC_EIR_MASK_SET(n)    (0x4100 + (n) * 4)
+#define rAIC_EIR_MASK_CLR(n)    (0x4180 + (n) * 4)
+
+#define rSPICON         0x00
+#define rSPISETUP       0x04
+
+#define rI2S_CTRL       0x00
+#define rI2S_RATE       0x04
+#define rI2S_DMA_ADDR   0x10
+#define rI2S_DMA_LEN    0x14
+#define rI2S_DMA_CTRL   0x18
+#define rI2S_DMA_STATUS 0x1C
+#define rI2S_DMA_POS    0x20
+#define I2S_DMA_STATUS_BUSY (1 << 0)
+#define I2S_DMA_STATUS_DONE (1 << 1)
+
+#define GPIOPADPINS     8
+#define rGPIOCFG(pad, pin)  (((pad) * GPIOPADPINS + (pin)) * 4)
+
+#define rPMGR_PLL_CTL0(n)   ((n) * 0x18)
+#define PMGR_PLL_REAL_LOCK  (1 << 29)
+#define rPMGR_PLL_DEBUG(n)  (0x2010 + (n) * 4)
+#define PMGR_PLL_DEBUG_BYP_ENABLED  (1 << 30)
+#define rPMGR_DOUBLER_DEBUG (0x2034)
+#define PMGR_DOUBLER_DEBUG_BYP_ENABLED  (1 << 30)
+#define rPMGR_SCRATCH0      (0x6000)
+
+#define rCFG_FUSE0      0x00
+
+/* A SecureROM stand-in: "b ." at the reset vector */
+static const uint8_t idle_rom[] = { 0xfe, 0xff, 0xff, 0xea };
+
+static QTestState *s5l8950x_init_machine(const char *machine)
+{
+    g_autofree char *romtmp = NULL;
+    QTestState *qts;
+    ssize_t wlen;
+    int fd;
+
+    fd = g_file_open_tmp("qtest-s5l8950x-XXXXXX", &romtmp, NULL);
+    g_assert(fd != -1);
+    wlen = write(fd, idle_rom, sizeof(idle_rom));
+    g_assert(wlen == sizeof(idle_rom));
+    close(fd);
+
+    /* Device tests don't touch SDRAM, run with the smallest size */
+    qts = qtest_initf("-machine %s -m 16M -bios %s", machine, romtmp);
+    unlink(romtmp);
+
+    return qts;
+}
+
+static QTestState *s5l8950x_init(void)
+{
+    return s5l8950x_init_machine("iphone-n42ap");
+}
+
+static void test_aic_timebase(void)
+{
+    QTestState *qts = s5l8950x_init();
+    uint64_t t0, t1;
+
+    t0 = qtest_readl(qts, AIC_BASE + rAIC_TIME_LO) |
+         (uint64_t)qtest_readl(qts, AIC_BASE + rAIC_TIME_HI) << 32;
+    qtest_clock_step(qts, 1000000);
+    t1 = qtest_readl(qts, AIC_BASE + rAIC_TIME_LO) |
+         (uint64_t)qtest_readl(qts, AIC_BASE + rAIC_TIME_HI) << 32;
+
+    g_assert_cmpuint(t1 - t0, >=, 1000000);
+
+    qtest_quit(qts);
+}
+
+static void test_aic_mask(void)
+{
+    QTestState *qts = s5l8950x_init();
+
+    /* All external interrupts are masked out of reset */
+    g_assert_cmphex(qtest_readl(qts, AIC_BASE + rAIC_EIR_MASK_SET(0)), ==,
+                    0xffffffff);
+    qtest_writel(qts, AIC_BASE + rAIC_EIR_MASK_CLR(0), 0x00000011);
+    g_assert_cmphex(qtest_readl(qts, AIC_BASE + rAIC_EIR_MASK_SET(0)), ==,
+                    0xffffffee);
+    qtest_writel(qts, AIC_BASE + rAIC_EIR_MASK_SET(0), 0x00000001);
+    g_assert_cmphex(qtest_readl(qts, AIC_BASE + rAIC_EIR_MASK_SET(0)), ==,
+                    0xffffffef);
+
+    qtest_quit(qts);
+}
+
+static void test_spi(void)
+{
+    QTestState *qts = s5l8950x_init();
+    int i;
+
+    for (i = 0; i < NUM_SPI; i++) {
+        g_assert_cmphex(qtest_readl(qts, SPI_BASE(i) + rSPICON), ==, 0);
+        qtest_writel(qts, SPI_BASE(i) + rSPISETUP, 0x100 + i);
+    }
+    /* Each controller keeps its own register file */
+    for (i = 0; i < NUM_SPI; i++) {
+        g_assert_cmphex(qtest_readl(qts, SPI_BASE(i) + rSPISETUP), ==,
+                        0x100 + i);
+    }
+
+    qtest_quit(qts);
+}
+
+static void test_gpio_boot_straps(void)
+{
+    QTestState *qts = s5l8950x_init();
+
+    /* DFU request buttons are pulled up, force-DFU is low */
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(0, 0)), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(0, 1)), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(25, 6)), ==, 0);
+
+    /* Pin configuration is latched */
+    qtest_writel(qts, GPIO_BASE + rGPIOCFG(3, 2), 0x00000203);
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(3, 2)), ==,
+                    0x00000203);
+
+    qtest_quit(qts);
+}
+
+static void test_gpio_board_id(void)
+{
+    QTestState *qts = s5l8950x_init_machine("iphone-n48ap");
+
+    /* N48AP is board ID 0xA, strapped LSB first on pad 23 */
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(23, 0)), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(23, 1)), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(23, 2)), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, GPIO_BASE + rGPIOCFG(23, 3)), ==, 1);
+
+    qtest_quit(qts);
+}
+
+static void test_pmgr(void)
+{
+    QTestState *qts = s5l8950x_init();
+    int i;
+
+    g_assert_cmphex(qtest_readl(qts, PMGR_BASE + rPMGR_PLL_CTL0(4)) &
+                    PMGR_PLL_REAL_LOCK, ==, PMGR_PLL_REAL_LOCK);
+    for (i = 2; i <= 8; i++) {
+        g_assert_cmphex(qtest_readl(qts, PMGR_BASE + rPMGR_PLL_DEBUG(i)), ==,
+                        PMGR_PLL_DEBUG_BYP_ENABLED);
+    }
+    g_assert_cmphex(qtest_readl(qts, PMGR_BASE + rPMGR_DOUBLER_DEBUG), ==,
+                    PMGR_DOUBLER_DEBUG_BYP_ENABLED);
+    /* Boot config selects NAND on FMI0 */
+    g_assert_cmphex(qtest_readl(qts, PMGR_BASE + rPMGR_SCRATCH0) >> 8 & 0xff,
+                    ==, 4);
+
+    qtest_quit(qts);
+}
+
+static void test_audio_null_sink(void)
+{
+    QTestState *qts = s5l8950x_init();
+
+    /* One second of 48 kHz S16LE stereo */
+    qtest_writel(qts, AUDIO_BASE + rI2S_CTRL, 0x3);
+    qtest_writel(qts, AUDIO_BASE + rI2S_RATE, 48000);
+    qtest_writel(qts, AUDIO_BASE + rI2S_DMA_ADDR, 0x10000000);
+    qtest_writel(qts, AUDIO_BASE + rI2S_DMA_LEN, 48000 * 4);
+    qtest_writel(qts, AUDIO_BASE + rI2S_DMA_CTRL, 0x1);
+    g_assert_cmphex(qtest_readl(qts, AUDIO_BASE + rI2S_DMA_STATUS), ==,
+                    I2S_DMA_STATUS_BUSY);
+
+    /* Progress follows virtual time */
+    qtest_clock_step(qts, 500000000);
+    g_assert_cmpuint(qtest_readl(qts, AUDIO_BASE + rI2S_DMA_POS), ==,
+                     24000 * 4);
+    g_assert_cmphex(qtest_readl(qts, AUDIO_BASE + rI2S_DMA_STATUS), ==,
+                    I2S_DMA_STATUS_BUSY);
+
+    qtest_clock_step(qts, 500000000);
+    g_assert_cmphex(qtest_readl(qts, AUDIO_BASE + rI2S_DMA_STATUS), ==,
+                    I2S_DMA_STATUS_DONE);
+    g_assert_cmpuint(qtest_readl(qts, AUDIO_BASE + rI2S_DMA_POS), ==,
+                     48000 * 4);
+
+    /* DONE is write 1 to clear */
+    qtest_writel(qts, AUDIO_BASE + rI2S_DMA_STATUS, I2S_DMA_STATUS_DONE);
+    g_assert_cmphex(qtest_readl(qts, AUDIO_BASE + rI2S_DMA_STATUS), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void test_chipid(void)
+{
+    QTestState *qts = s5l8950x_init();
+
+    /* Development, insecure fused part */
+    g_assert_cmphex(qtest_readl(qts, CHIPID_BASE + rCFG_FUSE0), ==, 0);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/s5l8950x/aic/timebase", test_aic_timebase);
+    qtest_add_func("/s5l8950x/aic/mask", test_aic_mask);
+    qtest_add_func("/s5l8950x/spi", test_spi);
+    qtest_add_func("/s5l8950x/gpio/boot_straps", test_gpio_boot_straps);
+    qtest_add_func("/s5l8950x/gpio/board_id", test_gpio_board_id);
+    qtest_add_func("/s5l8950x/pmgr", test_pmgr);
+    qtest_add_func("/s5l8950x/chipid", test_chipid);
+    qtest_add_func("/s5l8950x/audio/null_sink", test_audio_null_sink);
+
+    return g_test_run();
+}
@@ -0,0 +1,172 @@
+/*
+ * Indirect branch and return target changes
+ *
+ * BX LR, POP {pc}, LDR pc and BLX reg jump straight to the target they
+ * took last time when it still matches.  Check that they follow a new
+ * target once they are warmed up: a return to another address, a call
+ * through a pointer that changes, deep recursion that overflows any
+ * return stack, and code rewritten in place.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifdef __thumb__
+#error "This test must be compiled for ARM"
+#endif
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define WARM 1000
+
+/* Return 0 from the call, or 1 if @alt makes swap_ret return elsewhere. */
+int ret_or_alt(int alt);
+/* Sum the words at @p up to @n, calling through the LDR pc in ldr_pc_ret */
+int ldr_pc_sum(const int *p, int n);
+
+asm("	.text\n"
+    "	.arm\n"
+    "	.global	ret_or_alt\n"
+    "	.type	ret_or_alt, %function\n"
+    "ret_or_alt:\n"
+    "	push	{r4, lr}\n"
+    "	adr	r1, 1f\n"
+    "	bl	swap_ret\n"
+    "	mov	r0, #0\n"
+    "	pop	{r4, pc}\n"
+    "1:	mov	r0, #1\n"
+    "	pop	{r4, pc}\n"
+    "	.size	ret_or_alt, . - ret_or_alt\n"
+    "swap_ret:\n"
+    "	cmp	r0, #0\n"
+    "	movne	lr, r1\n"
+    "	bx	lr\n"
+    "	.global	ldr_pc_sum\n"
+    "	.type	ldr_pc_sum, %function\n"
+    "ldr_pc_sum:\n"
+    "	push	{r4, lr}\n"
+    "	mov	r2, #0\n"
+    "2:	subs	r1, r1, #1\n"
+    "	blt	3f\n"
+    "	bl	ldr_pc_ret\n"
+    "	b	2b\n"
+    "3:	mov	r0, r2\n"
+    "	pop	{r4, pc}\n"
+    "	.size	ldr_pc_sum, . - ldr_pc_sum\n"
+    "ldr_pc_ret:\n"
+    "	str	lr, [sp, #-8]!\n"
+    "	ldr	r3, [r0], #4\n"
+    "	add	r2, r2, r3\n"
+    "	ldr	pc, [sp], #8\n");
+
+static int __attribute__((noinline)) one(void)
+{
+    return 1;
+}
+
+static int __attribute__((noinline)) two(void)
+{
+    return 2;
+}
+
+static int __attribute__((noinline)) depth(int n)
+{
+    int r;
+
+    if (n == 0) {
+        return 0;
+    }
+    r = depth(n - 1);
+    /* Keep the call a real call */
+    asm volatile("" : "+r" (r));
+    return r + 1;
+}
+
+static int (*volatile fp)(void);
+
+static void test_return(void)
+{
+    int i;
+
+    for (i = 0; i < WARM; i++) {
+        assert(ret_or_alt(0) == 0);
+    }
+    assert(ret_or_alt(1) == 1);
+    for (i = 0; i < WARM; i++) {
+        assert(ret_or_alt(i & 1) == (i & 1));
+    }
+}
+
+static void test_ldr_pc(void)
+{
+    static const int v[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    int i;
+
+    for (i = 0; i < WARM; i++) {
+        assert(ldr_pc_sum(v, 8) == 36);
+        assert(ldr_pc_sum(v + 4, 4) == 26);
+    }
+}
+
+static void test_call(void)
+{
+    int i, sum = 0;
+
+    for (i = 0; i < 2 * WARM; i++) {
+        fp = i < WARM ? one : two;
+        sum += fp();
+    }
+    assert(sum == 3 * WARM);
+}
+
+static void test_recursion(void)
+{
+    int i;
+
+    for (i = 0; i < WARM; i++) {
+        assert(depth(i % 50) == i % 50);
+    }
+}
+
+static void test_rewrite(void)
+{
+    /* mov r0, #n; bx lr */
+    uint32_t code[2] = { 0xe3a00001, 0xe12fff1e };
+    int (*fn)(void);
+    void *buf;
+    int i;
+
+    buf = mmap(NULL, 4096, PROT_READ | PROT_WRITE | PROT_EXEC,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(buf != MAP_FAILED);
+    fn = buf;
+
+    memcpy(buf, code, sizeof(code));
+    __builtin___clear_cache(buf, buf + sizeof(code));
+    for (i = 0; i < WARM; i++) {
+        fp = fn;
+        assert(fp() == 1);
+    }
+
+    code[0] = 0xe3a00002;
+    memcpy(buf, code, sizeof(code));
+    __builtin___clear_cache(buf, buf + sizeof(code));
+    fp = fn;
+    assert(fp() == 2);
+
+    munmap(buf, 4096);
+}
+
+int main(void)
+{
+    test_return();
+    test_ldr_pc();
+    test_call();
+    test_recursion();
+    test_rewrite();
+    printf("PASS\n");
+    return 0;
+}
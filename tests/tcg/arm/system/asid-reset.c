@@ -0,0 +1,90 @@
+/*
+ * ASID switch across a CPU reset
+ *
+ * The TLB keeps the entries of recently used ASIDs around instead of
+ * flushing them when CONTEXTIDR changes.  A reset puts CONTEXTIDR back
+ * to 0 behind the back of that tracking: check that the translations
+ * loaded after the reset are not kept when switching to the ASID that
+ * was current before it.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <minilib.h>
+#include "smp.h"
+
+#define TEST_VA     0x70000000
+#define TEST_PA(n)  (RAM_BASE + RAM_SIZE - (3 - (n)) * (1 << 20))
+#define TEST_VAL(n) (0xa5a50000 + (n))
+
+static uint32_t tt[3][4096] __attribute__((aligned(16384)));
+static volatile uint32_t phase;
+static volatile uint32_t result[3];
+
+void secondary_main(uint32_t boot)
+{
+    volatile uint32_t *va = (volatile uint32_t *)TEST_VA;
+
+    if (boot == 0) {
+        int i;
+
+        /* Still running with the MMU off */
+        for (i = 0; i < 3; i++) {
+            *(volatile uint32_t *)TEST_PA(i) = TEST_VAL(i);
+        }
+        set_contextidr(1);
+        mmu_enable(tt[0]);
+        result[0] = *va;
+    } else {
+        /* CONTEXTIDR was reset to ASID 0 */
+        tlbiall();
+        mmu_enable(tt[1]);
+        result[1] = *va;
+
+        set_contextidr(1);
+        set_ttbr0(tt[2]);
+        result[2] = *va;
+    }
+
+    dsb();
+    phase = boot + 1;
+    dsb();
+    psci_cpu_off();
+}
+
+int main(void)
+{
+    int i, ret;
+
+    ml_printf("ASID switch across reset\n");
+
+    for (i = 0; i < 3; i++) {
+        map_ram(tt[i]);
+        tt[i][TEST_VA >> 20] = TEST_PA(i) | SECTION | SECTION_NG;
+    }
+    dsb();
+
+    for (i = 0; i < 2; i++) {
+        /* CPU_ON resets the CPU before it enters secondary_main */
+        ret = psci_cpu_on(1, i);
+        if (ret) {
+            ml_printf("FAIL: CPU_ON returned %d\n", ret);
+            return 1;
+        }
+        while (phase != i + 1) {
+            /* spin */
+        }
+        psci_wait_off(1);
+    }
+
+    for (i = 0; i < 3; i++) {
+        ml_printf("table %d: read %x\n", i, result[i]);
+        if (result[i] != TEST_VAL(i)) {
+            ml_printf("FAIL: expected %x\n", TEST_VAL(i));
+            return 1;
+        }
+    }
+    ml_printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Helpers for the SMP system tests
+ *
+ * On the virt machine without EL2 and EL3 the secondary CPUs start
+ * powered off, and are started through QEMU's PSCI emulation over HVC.
+ * A test including this provides secondary_main(), which is entered
+ * with the MMU off and the context id passed to psci_cpu_on().
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef ARM_SYSTEM_SMP_H
+#define ARM_SYSTEM_SMP_H
+
+#include <stdint.h>
+
+#define PSCI_CPU_OFF            0x84000002
+#define PSCI_CPU_ON             0x84000003
+#define PSCI_AFFINITY_INFO      0x84000004
+#define PSCI_AFFINITY_OFF       1
+
+/* Short descriptor section, RW @ PL1, as set up by boot.S */
+#define SECTION                 0x0000040e
+#define SECTION_NG              (1 << 17)
+
+/* RAM of the virt machine, mapped with 1MB sections */
+#define RAM_BASE                0x40000000
+#define RAM_SIZE                (128 << 20)
+
+void secondary_main(uint32_t context);
+void secondary_entry(void);
+
+uint8_t secondary_stack[4096] __attribute__((aligned(8)));
+
+asm("	.text\n"
+    "	.global	secondary_entry\n"
+    "	.type	secondary_entry, %function\n"
+#ifdef __thumb__
+    "	.thumb_func\n"
+#endif
+    "secondary_entry:\n"
+    "	ldr	sp, =secondary_stack + 4096\n"
+    "	ldr	r1, =vector_table\n"
+    "	mcr	p15, 0, r1, c12, c0, 0\n"	/* VBAR */
+    "	bl	secondary_main\n"
+    "1:	b	1b\n"
+    "	.ltorg\n");
+
+static inline uint32_t psci_call(uint32_t fn, uint32_t a0, uint32_t a1,
+                                 uint32_t a2)
+{
+    register uint32_t r0 asm("r0") = fn;
+    register uint32_t r1 asm("r1") = a0;
+    register uint32_t r2 asm("r2") = a1;
+    register uint32_t r3 asm("r3") = a2;
+
+    /* hvc #0, without requiring the virtualization extensions in gas */
+#ifdef __thumb__
+    asm volatile(".inst.w 0xf7e08000"
+                 : "+r" (r0) : "r" (r1), "r" (r2), "r" (r3) : "memory");
+#else
+    asm volatile(".inst 0xe1400070"
+                 : "+r" (r0) : "r" (r1), "r" (r2), "r" (r3) : "memory");
+#endif
+    return r0;
+}
+
+static inline int psci_cpu_on(uint32_t cpu, uint32_t context)
+{
+    return psci_call(PSCI_CPU_ON, cpu, (uint32_t)secondary_entry, context);
+}
+
+static inline void psci_cpu_off(void)
+{
+    psci_call(PSCI_CPU_OFF, 0, 0, 0);
+}
+
+static inline void psci_wait_off(uint32_t cpu)
+{
+    while (psci_call(PSCI_AFFINITY_INFO, cpu, 0, 0) != PSCI_AFFINITY_OFF) {
+        /* spin */
+    }
+}
+
+static inline void dsb(void)
+{
+    asm volatile("dsb" : : : "memory");
+}
+
+static inline void isb(void)
+{
+    asm volatile("isb" : : : "memory");
+}
+
+static inline void set_contextidr(uint32_t value)
+{
+    asm volatile("mcr p15, 0, %0, c13, c0, 1" : : "r" (value) : "memory");
+    isb();
+}
+
+static inline void set_ttbr0(uint32_t *table)
+{
+    asm volatile("mcr p15, 0, %0, c2, c0, 0" : : "r" (table) : "memory");
+    isb();
+}
+
+static inline void tlbiall(void)
+{
+    asm volatile("mcr p15, 0, %0, c8, c7, 0" : : "r" (0) : "memory");
+    dsb();
+    isb();
+}
+
+static inline void tlbimva(uint32_t mva)
+{
+    asm volatile("mcr p15, 0, %0, c8, c7, 1" : : "r" (mva) : "memory");
+}
+
+static inline void tlbimvais(uint32_t mva)
+{
+    asm volatile("mcr p15, 0, %0, c8, c3, 1" : : "r" (mva) : "memory");
+}
+
+/* Identity map all of RAM with global sections. */
+static inline void map_ram(uint32_t *table)
+{
+    uint32_t pa;
+
+    for (pa = RAM_BASE; pa < RAM_BASE + RAM_SIZE; pa += 1 << 20) {
+        table[pa >> 20] = pa | SECTION;
+    }
+}
+
+/* Turn the MMU on with @table, using domain 0 and TTBR0 only. */
+static inline void mmu_enable(uint32_t *table)
+{
+    asm volatile("mcr p15, 0, %0, c3, c0, 0" : : "r" (1));     /* DACR */
+    asm volatile("mcr p15, 0, %0, c2, c0, 2" : : "r" (0));     /* TTBCR */
+    set_ttbr0(table);
+    asm volatile("mcr p15, 0, %0, c1, c0, 0" : : "r" (0x1005)); /* SCTLR */
+    isb();
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * TLBI IS completion at DSB
+ *
+ * Broadcast TLB maintenance may be batched up until the next DSB, but
+ * once the DSB on the issuing CPU has completed, no other CPU may use
+ * the old translation.  CPU 1 keeps reading through a mapping while
+ * CPU 0 remaps it and invalidates it with TLBIMVAIS, then checks what
+ * CPU 1 reads once CPU 0 signals after the DSB.  Every other round
+ * surrounds the TLBIMVAIS with local invalidates of unrelated pages,
+ * so that it is queued in the middle of a local batch.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <minilib.h>
+#include "smp.h"
+
+#define ROUNDS      100
+#define TEST_VA     0x70000000
+#define FAR_VA      0x71000000
+#define TEST_PA(n)  (RAM_BASE + RAM_SIZE - (2 - (n)) * (1 << 20))
+#define TEST_VAL(n) (0x5a5a0000 + (n))
+
+static uint32_t tt[4096] __attribute__((aligned(16384)));
+static volatile uint32_t ready, go, done, seen;
+
+void secondary_main(uint32_t context)
+{
+    volatile uint32_t *va = (volatile uint32_t *)TEST_VA;
+    uint32_t r;
+
+    mmu_enable(tt);
+
+    for (r = 1; r <= ROUNDS; r++) {
+        /* Make sure the old translation is cached */
+        (void)*va;
+        ready = r;
+        while (go != r) {
+            (void)*va;
+        }
+        dsb();
+        seen = *va;
+        dsb();
+        done = r;
+    }
+
+    psci_cpu_off();
+}
+
+int main(void)
+{
+    uint32_t r;
+    int ret;
+
+    ml_printf("TLBI IS completion at DSB\n");
+
+    map_ram(tt);
+    *(volatile uint32_t *)TEST_PA(0) = TEST_VAL(0);
+    *(volatile uint32_t *)TEST_PA(1) = TEST_VAL(1);
+    tt[TEST_VA >> 20] = TEST_PA(0) | SECTION;
+    dsb();
+
+    ret = psci_cpu_on(1, 0);
+    if (ret) {
+        ml_printf("FAIL: CPU_ON returned %d\n", ret);
+        return 1;
+    }
+
+    for (r = 1; r <= ROUNDS; r++) {
+        while (ready != r) {
+            /* spin */
+        }
+
+        tt[TEST_VA >> 20] = TEST_PA(r & 1) | SECTION;
+        dsb();
+        if (r & 2) {
+            tlbimva(FAR_VA);
+        }
+        tlbimvais(TEST_VA);
+        if (r & 2) {
+            tlbimva(FAR_VA + (4 << 20));
+        }
+        dsb();
+        isb();
+        go = r;
+
+        while (done != r) {
+            /* spin */
+        }
+        if (seen != TEST_VAL(r & 1)) {
+            ml_printf("FAIL: round %d read %x, expected %x\n",
+                      r, seen, TEST_VAL(r & 1));
+            return 1;
+        }
+    }
+
+    psci_wait_off(1);
+    ml_printf("PASS\n");
+    return 0;
+}